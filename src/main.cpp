@@ -117,7 +117,8 @@ void UCISetOption(Searcher& searcher, Board& board, char* str) {
 
     // Sets the size of the transposition table
     if (OptionName(str, "Hash")) {
-        searcher.TT.resize((uint64_t)atoi(OptionValue(str)));
+        searcher.resizeTT((uint64_t)atoi(OptionValue(str)));
+        std::cout << "info string " << searcher.TT.allocationInfo() << std::endl;
         // Sets number of threads to use for searching
     } else if (OptionName(str, "Threads")) {
         searcher.initialize(atoi(OptionValue(str)));
@@ -133,6 +134,25 @@ void UCISetOption(Searcher& searcher, Board& board, char* str) {
     } else if (OptionName(str, "NormalizeEval")) {
         std::string opt = OptionValue(str);
         searcher.toggleNorm(opt == "true");
+    } else if (OptionName(str, "ShowStats")) {
+        std::string opt = OptionValue(str);
+        searcher.toggleStats(opt == "true");
+    } else if (OptionName(str, "MultiPV")) {
+        searcher.setMultiPV(atoi(OptionValue(str)));
+    } else if (OptionName(str, "Ponder")) {
+        std::string opt = OptionValue(str);
+        searcher.togglePonder(opt == "true");
+    } else if (OptionName(str, "ThreadBinding")) {
+        std::string opt = OptionValue(str) != nullptr ? OptionValue(str) : "none";
+        searcher.setThreadBinding(opt);
+        std::cout << "info string ThreadBinding " << opt << " over " << NUMA::nodes().size() << " NUMA nodes"
+                  << std::endl;
+    } else if (OptionName(str, "AsyncClear")) {
+        std::string opt = OptionValue(str);
+        searcher.toggleAsyncClear(opt == "true");
+    } else if (OptionName(str, "TTEvalStores")) {
+        std::string opt = OptionValue(str);
+        searcher.toggleTTEvalStores(opt == "true");
     } else {
         for (auto& param : tunables()) {
             const char* p = param.name.c_str();
@@ -164,6 +184,7 @@ void UCISetOption(Searcher& searcher, Board& board, char* str) {
         PieceValue[2] = BISHOP_VALUE();
         PieceValue[3] = ROOK_VALUE();
         PieceValue[4] = QUEEN_VALUE();
+        searcher.clearEvalCaches();
     }
 }
 void UCIInfo() {
@@ -176,6 +197,12 @@ void UCIInfo() {
     std::cout << "option name UCI_Chess960 type check default false\n";
     std::cout << "option name UseSoftNodes type check default false\n";
     std::cout << "option name NormalizeEval type check default true\n";
+    std::cout << "option name ShowStats type check default false\n";
+    std::cout << "option name MultiPV type spin default 1 min 1 max 256\n";
+    std::cout << "option name Ponder type check default false\n";
+    std::cout << "option name ThreadBinding type string default none\n";
+    std::cout << "option name AsyncClear type check default false\n";
+    std::cout << "option name TTEvalStores type check default true\n";
 #ifdef TUNE
     for (auto& param : tunables()) {
         std::cout << "option name " << param.name << " type spin default " << param.defaultValue << " min " << param.min
@@ -220,16 +247,57 @@ void UCIEvaluate(Board& board) {
     std::cout << "Normalized: " << scaleEval(eval, board) << std::endl;
 }
 
+void UCIIsReady(Searcher& searcher) {
+    // isready may come during a search, the pool only prepares its histories when idle
+    if (!searcher.isSearching())
+        searcher.prepareThreads();
+    std::cout << "readyok" << std::endl;
+}
+
 void UCIGo(Searcher& searcher, Board& board, char* str) {
-    // searcher.stop();
+    // A search still running would read the new pondering flag, end it first
+    searcher.stopSearching();
+    searcher.waitForSearchFinished();
 
     Search::Limit limit = Search::Limit();
     ParseTimeControl(str, board.sideToMove(), limit, searcher.useSoft);
 
-    searcher.startSearching(board, limit);
+    searcher.pondering = strstr(str, "ponder") != nullptr;
+
+    // searchmoves <move> ... runs to the end of the command
+    std::vector<Move> searchMoves;
+    if ((str = strstr(str, "searchmoves")) != NULL) {
+        char* move = strtok(str, " ");
+        while ((move = strtok(NULL, " ")))
+            searchMoves.push_back(uci::uciToMove(board, move));
+    }
+    searcher.startSearching(board, limit, searchMoves);
     // searcher.stop();
 }
 
+// savehash <file>
+void UCISaveHash(Searcher& searcher, char* str) {
+    std::string path = str + strlen("savehash");
+    path.erase(0, path.find_first_not_of(' '));
+    searcher.waitForSearchFinished();
+    if (searcher.TT.save(path))
+        std::cout << "info string saved " << searcher.TT.mbSize << "MB hash to " << path << std::endl;
+    else
+        std::cout << "info string failed to save hash to " << path << std::endl;
+}
+
+// loadhash <file>
+void UCILoadHash(Searcher& searcher, char* str) {
+    std::string path = str + strlen("loadhash");
+    path.erase(0, path.find_first_not_of(' '));
+    searcher.waitForSearchFinished();
+    std::string error;
+    if (searcher.TT.load(path, error))
+        std::cout << "info string loaded " << searcher.TT.mbSize << "MB hash from " << path << std::endl;
+    else
+        std::cout << "info string failed to load hash: " << error << std::endl;
+}
+
 void BeginDatagen(char* str, bool isDFRC) {
     // Same way as setoption
     // datagen name Threads value 16
@@ -242,69 +310,78 @@ void BeginDatagen(char* str, bool isDFRC) {
         std::cout << "DFRC Enabled" << std::endl;
     startDatagen(threadc, isDFRC);
 }
+// Thanks Prelude
+static const std::array<std::string, 50> BENCH_FENS = {
+    "r3k2r/2pb1ppp/2pp1q2/p7/1nP1B3/1P2P3/P2N1PPP/R2QK2R w KQkq a6 0 14",
+    "4rrk1/2p1b1p1/p1p3q1/4p3/2P2n1p/1P1NR2P/PB3PP1/3R1QK1 b - - 2 24",
+    "r3qbrk/6p1/2b2pPp/p3pP1Q/PpPpP2P/3P1B2/2PB3K/R5R1 w - - 16 42",
+    "6k1/1R3p2/6p1/2Bp3p/3P2q1/P7/1P2rQ1K/5R2 b - - 4 44",
+    "8/8/1p2k1p1/3p3p/1p1P1P1P/1P2PK2/8/8 w - - 3 54",
+    "7r/2p3k1/1p1p1qp1/1P1Bp3/p1P2r1P/P7/4R3/Q4RK1 w - - 0 36",
+    "r1bq1rk1/pp2b1pp/n1pp1n2/3P1p2/2P1p3/2N1P2N/PP2BPPP/R1BQ1RK1 b - - 2 10",
+    "3r3k/2r4p/1p1b3q/p4P2/P2Pp3/1B2P3/3BQ1RP/6K1 w - - 3 87",
+    "2r4r/1p4k1/1Pnp4/3Qb1pq/8/4BpPp/5P2/2RR1BK1 w - - 0 42",
+    "4q1bk/6b1/7p/p1p4p/PNPpP2P/KN4P1/3Q4/4R3 b - - 0 37",
+    "2q3r1/1r2pk2/pp3pp1/2pP3p/P1Pb1BbP/1P4Q1/R3NPP1/4R1K1 w - - 2 34",
+    "1r2r2k/1b4q1/pp5p/2pPp1p1/P3Pn2/1P1B1Q1P/2R3P1/4BR1K b - - 1 37",
+    "r3kbbr/pp1n1p1P/3ppnp1/q5N1/1P1pP3/P1N1B3/2P1QP2/R3KB1R b KQkq b3 0 17",
+    "8/6pk/2b1Rp2/3r4/1R1B2PP/P5K1/8/2r5 b - - 16 42",
+    "1r4k1/4ppb1/2n1b1qp/pB4p1/1n1BP1P1/7P/2PNQPK1/3RN3 w - - 8 29",
+    "8/p2B4/PkP5/4p1pK/4Pb1p/5P2/8/8 w - - 29 68",
+    "3r4/ppq1ppkp/4bnp1/2pN4/2P1P3/1P4P1/PQ3PBP/R4K2 b - - 2 20",
+    "5rr1/4n2k/4q2P/P1P2n2/3B1p2/4pP2/2N1P3/1RR1K2Q w - - 1 49",
+    "1r5k/2pq2p1/3p3p/p1pP4/4QP2/PP1R3P/6PK/8 w - - 1 51",
+    "q5k1/5ppp/1r3bn1/1B6/P1N2P2/BQ2P1P1/5K1P/8 b - - 2 34",
+    "r1b2k1r/5n2/p4q2/1ppn1Pp1/3pp1p1/NP2P3/P1PPBK2/1RQN2R1 w - - 0 22",
+    "r1bqk2r/pppp1ppp/5n2/4b3/4P3/P1N5/1PP2PPP/R1BQKB1R w KQkq - 0 5",
+    "r1bqr1k1/pp1p1ppp/2p5/8/3N1Q2/P2BB3/1PP2PPP/R3K2n b Q - 1 12",
+    "r1bq2k1/p4r1p/1pp2pp1/3p4/1P1B3Q/P2B1N2/2P3PP/4R1K1 b - - 2 19",
+    "r4qk1/6r1/1p4p1/2ppBbN1/1p5Q/P7/2P3PP/5RK1 w - - 2 25",
+    "r7/6k1/1p6/2pp1p2/7Q/8/p1P2K1P/8 w - - 0 32",
+    "r3k2r/ppp1pp1p/2nqb1pn/3p4/4P3/2PP4/PP1NBPPP/R2QK1NR w KQkq - 1 5",
+    "3r1rk1/1pp1pn1p/p1n1q1p1/3p4/Q3P3/2P5/PP1NBPPP/4RRK1 w - - 0 12",
+    "5rk1/1pp1pn1p/p3Brp1/8/1n6/5N2/PP3PPP/2R2RK1 w - - 2 20",
+    "8/1p2pk1p/p1p1r1p1/3n4/8/5R2/PP3PPP/4R1K1 b - - 3 27",
+    "8/4pk2/1p1r2p1/p1p4p/Pn5P/3R4/1P3PP1/4RK2 w - - 1 33",
+    "8/5k2/1pnrp1p1/p1p4p/P6P/4R1PK/1P3P2/4R3 b - - 1 38",
+    "8/8/1p1kp1p1/p1pr1n1p/P6P/1R4P1/1P3PK1/1R6 b - - 15 45",
+    "8/8/1p1k2p1/p1prp2p/P2n3P/6P1/1P1R1PK1/4R3 b - - 5 49",
+    "8/8/1p4p1/p1p2k1p/P2n1P1P/4K1P1/1P6/3R4 w - - 6 54",
+    "8/8/1p4p1/p1p2k1p/P2n1P1P/4K1P1/1P6/6R1 b - - 6 59",
+    "8/5k2/1p4p1/p1pK3p/P2n1P1P/6P1/1P6/4R3 b - - 14 63",
+    "8/1R6/1p1K1kp1/p6p/P1p2P1P/6P1/1Pn5/8 w - - 0 67",
+    "1rb1rn1k/p3q1bp/2p3p1/2p1p3/2P1P2N/PP1RQNP1/1B3P2/4R1K1 b - - 4 23",
+    "4rrk1/pp1n1pp1/q5p1/P1pP4/2n3P1/7P/1P3PB1/R1BQ1RK1 w - - 3 22",
+    "r2qr1k1/pb1nbppp/1pn1p3/2ppP3/3P4/2PB1NN1/PP3PPP/R1BQR1K1 w - - 4 12",
+    "2r2k2/8/4P1R1/1p6/8/P4K1N/7b/2B5 b - - 0 55",
+    "6k1/5pp1/8/2bKP2P/2P5/p4PNb/B7/8 b - - 1 44",
+    "2rqr1k1/1p3p1p/p2p2p1/P1nPb3/2B1P3/5P2/1PQ2NPP/R1R4K w - - 3 25",
+    "r1b2rk1/p1q1ppbp/6p1/2Q5/8/4BP2/PPP3PP/2KR1B1R b - - 2 14",
+    "6r1/5k2/p1b1r2p/1pB1p1p1/1Pp3PP/2P1R1K1/2P2P2/3R4 w - - 1 36",
+    "rnbqkb1r/pppppppp/5n2/8/2PP4/8/PP2PPPP/RNBQKBNR b KQkq c3 0 2",
+    "2rr2k1/1p4bp/p1q1p1p1/4Pp1n/2PB4/1PN3P1/P3Q2P/2RR2K1 w - f6 0 20",
+    "3br1k1/p1pn3p/1p3n2/5pNq/2P1p3/1PN3PP/P2Q1PB1/4R1K1 w - - 0 23",
+    "2r2b2/5p2/5k2/p1r1pP2/P2pB3/1P3P2/K1P3R1/7R w - - 23 93"
+};
+
 // Benchmark for OpenBench
 void bench(Searcher& searcher) {
     int64_t totalNodes = 0;
     int64_t totalMS = 0;
+    TTStats ttStats;
+    uint64_t evalProbes = 0;
+    uint64_t evalHits = 0;
+    uint64_t validations = 0;
+    uint64_t threatNodes = 0;
+    uint64_t threatComputations = 0;
 
     std::cout << "Benchmark started at depth " << (int)BENCH_DEPTH << std::endl;
-    // Thanks Prelude
-    std::array<std::string, 50> fens = {"r3k2r/2pb1ppp/2pp1q2/p7/1nP1B3/1P2P3/P2N1PPP/R2QK2R w KQkq a6 0 14",
-                                        "4rrk1/2p1b1p1/p1p3q1/4p3/2P2n1p/1P1NR2P/PB3PP1/3R1QK1 b - - 2 24",
-                                        "r3qbrk/6p1/2b2pPp/p3pP1Q/PpPpP2P/3P1B2/2PB3K/R5R1 w - - 16 42",
-                                        "6k1/1R3p2/6p1/2Bp3p/3P2q1/P7/1P2rQ1K/5R2 b - - 4 44",
-                                        "8/8/1p2k1p1/3p3p/1p1P1P1P/1P2PK2/8/8 w - - 3 54",
-                                        "7r/2p3k1/1p1p1qp1/1P1Bp3/p1P2r1P/P7/4R3/Q4RK1 w - - 0 36",
-                                        "r1bq1rk1/pp2b1pp/n1pp1n2/3P1p2/2P1p3/2N1P2N/PP2BPPP/R1BQ1RK1 b - - 2 10",
-                                        "3r3k/2r4p/1p1b3q/p4P2/P2Pp3/1B2P3/3BQ1RP/6K1 w - - 3 87",
-                                        "2r4r/1p4k1/1Pnp4/3Qb1pq/8/4BpPp/5P2/2RR1BK1 w - - 0 42",
-                                        "4q1bk/6b1/7p/p1p4p/PNPpP2P/KN4P1/3Q4/4R3 b - - 0 37",
-                                        "2q3r1/1r2pk2/pp3pp1/2pP3p/P1Pb1BbP/1P4Q1/R3NPP1/4R1K1 w - - 2 34",
-                                        "1r2r2k/1b4q1/pp5p/2pPp1p1/P3Pn2/1P1B1Q1P/2R3P1/4BR1K b - - 1 37",
-                                        "r3kbbr/pp1n1p1P/3ppnp1/q5N1/1P1pP3/P1N1B3/2P1QP2/R3KB1R b KQkq b3 0 17",
-                                        "8/6pk/2b1Rp2/3r4/1R1B2PP/P5K1/8/2r5 b - - 16 42",
-                                        "1r4k1/4ppb1/2n1b1qp/pB4p1/1n1BP1P1/7P/2PNQPK1/3RN3 w - - 8 29",
-                                        "8/p2B4/PkP5/4p1pK/4Pb1p/5P2/8/8 w - - 29 68",
-                                        "3r4/ppq1ppkp/4bnp1/2pN4/2P1P3/1P4P1/PQ3PBP/R4K2 b - - 2 20",
-                                        "5rr1/4n2k/4q2P/P1P2n2/3B1p2/4pP2/2N1P3/1RR1K2Q w - - 1 49",
-                                        "1r5k/2pq2p1/3p3p/p1pP4/4QP2/PP1R3P/6PK/8 w - - 1 51",
-                                        "q5k1/5ppp/1r3bn1/1B6/P1N2P2/BQ2P1P1/5K1P/8 b - - 2 34",
-                                        "r1b2k1r/5n2/p4q2/1ppn1Pp1/3pp1p1/NP2P3/P1PPBK2/1RQN2R1 w - - 0 22",
-                                        "r1bqk2r/pppp1ppp/5n2/4b3/4P3/P1N5/1PP2PPP/R1BQKB1R w KQkq - 0 5",
-                                        "r1bqr1k1/pp1p1ppp/2p5/8/3N1Q2/P2BB3/1PP2PPP/R3K2n b Q - 1 12",
-                                        "r1bq2k1/p4r1p/1pp2pp1/3p4/1P1B3Q/P2B1N2/2P3PP/4R1K1 b - - 2 19",
-                                        "r4qk1/6r1/1p4p1/2ppBbN1/1p5Q/P7/2P3PP/5RK1 w - - 2 25",
-                                        "r7/6k1/1p6/2pp1p2/7Q/8/p1P2K1P/8 w - - 0 32",
-                                        "r3k2r/ppp1pp1p/2nqb1pn/3p4/4P3/2PP4/PP1NBPPP/R2QK1NR w KQkq - 1 5",
-                                        "3r1rk1/1pp1pn1p/p1n1q1p1/3p4/Q3P3/2P5/PP1NBPPP/4RRK1 w - - 0 12",
-                                        "5rk1/1pp1pn1p/p3Brp1/8/1n6/5N2/PP3PPP/2R2RK1 w - - 2 20",
-                                        "8/1p2pk1p/p1p1r1p1/3n4/8/5R2/PP3PPP/4R1K1 b - - 3 27",
-                                        "8/4pk2/1p1r2p1/p1p4p/Pn5P/3R4/1P3PP1/4RK2 w - - 1 33",
-                                        "8/5k2/1pnrp1p1/p1p4p/P6P/4R1PK/1P3P2/4R3 b - - 1 38",
-                                        "8/8/1p1kp1p1/p1pr1n1p/P6P/1R4P1/1P3PK1/1R6 b - - 15 45",
-                                        "8/8/1p1k2p1/p1prp2p/P2n3P/6P1/1P1R1PK1/4R3 b - - 5 49",
-                                        "8/8/1p4p1/p1p2k1p/P2n1P1P/4K1P1/1P6/3R4 w - - 6 54",
-                                        "8/8/1p4p1/p1p2k1p/P2n1P1P/4K1P1/1P6/6R1 b - - 6 59",
-                                        "8/5k2/1p4p1/p1pK3p/P2n1P1P/6P1/1P6/4R3 b - - 14 63",
-                                        "8/1R6/1p1K1kp1/p6p/P1p2P1P/6P1/1Pn5/8 w - - 0 67",
-                                        "1rb1rn1k/p3q1bp/2p3p1/2p1p3/2P1P2N/PP1RQNP1/1B3P2/4R1K1 b - - 4 23",
-                                        "4rrk1/pp1n1pp1/q5p1/P1pP4/2n3P1/7P/1P3PB1/R1BQ1RK1 w - - 3 22",
-                                        "r2qr1k1/pb1nbppp/1pn1p3/2ppP3/3P4/2PB1NN1/PP3PPP/R1BQR1K1 w - - 4 12",
-                                        "2r2k2/8/4P1R1/1p6/8/P4K1N/7b/2B5 b - - 0 55",
-                                        "6k1/5pp1/8/2bKP2P/2P5/p4PNb/B7/8 b - - 1 44",
-                                        "2rqr1k1/1p3p1p/p2p2p1/P1nPb3/2B1P3/5P2/1PQ2NPP/R1R4K w - - 3 25",
-                                        "r1b2rk1/p1q1ppbp/6p1/2Q5/8/4BP2/PPP3PP/2KR1B1R b - - 2 14",
-                                        "6r1/5k2/p1b1r2p/1pB1p1p1/1Pp3PP/2P1R1K1/2P2P2/3R4 w - - 1 36",
-                                        "rnbqkb1r/pppppppp/5n2/8/2PP4/8/PP2PPPP/RNBQKBNR b KQkq c3 0 2",
-                                        "2rr2k1/1p4bp/p1q1p1p1/4Pp1n/2PB4/1PN3P1/P3Q2P/2RR2K1 w - f6 0 20",
-                                        "3br1k1/p1pn3p/1p3n2/5pNq/2P1p3/1PN3PP/P2Q1PB1/4R1K1 w - - 0 23",
-                                        "2r2b2/5p2/5k2/p1r1pP2/P2pB3/1P3P2/K1P3R1/7R w - - 23 93"};
 
     TimeLimit timer = TimeLimit();
     searcher.printInfo = false;
     searcher.waitForSearchFinished();
     searcher.reset();
-    for (auto fen : fens) {
+    for (auto fen : BENCH_FENS) {
         timer.start();
         Board board(fen);
         Search::Limit limit = Search::Limit();
@@ -318,6 +395,14 @@ void bench(Searcher& searcher) {
         int ms = timer.elapsed();
         totalMS += ms;
         totalNodes += searcher.nodeCount();
+        ttStats.merge(searcher.ttStats());
+        auto [probes, hits] = searcher.evalCacheStats();
+        evalProbes += probes;
+        evalHits += hits;
+        validations += searcher.moveValidations();
+        auto [nodes, computed] = searcher.threatStats();
+        threatNodes += nodes;
+        threatComputations += computed;
 
         std::cout << "-----------------------------------------------------------------------" << std::endl;
         std::cout << "FEN: " << fen << std::endl;
@@ -331,10 +416,302 @@ void bench(Searcher& searcher) {
     int nps = static_cast<int64_t>((totalNodes / totalMS) * 1000);
     std::cout << "Average NPS: " << nps << std::endl;
     std::cout << totalNodes << " nodes " << nps << " nps" << std::endl;
+    std::cout << "TT probes: " << ttStats.probes << std::endl;
+    std::cout << "TT hits: " << ttStats.hits << " (" << 100.0 * ttStats.hits / std::max<uint64_t>(ttStats.probes, 1) << "%)" << std::endl;
+    std::cout << "TT corrupt moves: " << ttStats.corrupt << std::endl;
+#ifdef TT_VERIFY
+    std::cout << "TT false positives: " << ttStats.falsePositives << std::endl;
+#endif
+#ifdef PREFETCH_VERIFY
+    std::cout << "Prefetch mismatches: " << ttStats.prefetchMismatches << std::endl;
+#endif
+    std::cout << "TT layout: " << TTable::layoutInfo() << std::endl;
+    std::cout << "Move validations: " << validations << " (" << validations * 1000 / std::max<int64_t>(totalMS, 1) << "/s)" << std::endl;
+    std::cout << "Threat maps: " << threatComputations << " of " << threatNodes << " nodes ("
+              << threatNodes - threatComputations << " avoided)" << std::endl;
+    std::cout << "Eval cache hits: " << evalHits << " (" << 100.0 * evalHits / std::max<uint64_t>(evalProbes, 1) << "%)" << std::endl;
+
+    searcher.printInfo = true;
+}
+
+// Bytes held by the TT, every search thread, the network and lookup tables, with how
+// much of each is backed by huge pages
+void UCIMemory(Searcher& searcher) {
+    searcher.waitForSearchFinished();
+    std::vector<MemoryRegion> regions = memoryRegions();
+    auto huge = [&](const void* ptr, size_t bytes) {
+        return regions.empty() ? std::string("unknown") : std::to_string(hugePageBytes(regions, ptr, bytes));
+    };
+    size_t total = 0;
+
+    std::cout << "info string memory tt " << searcher.TT.bytes() << " huge " << huge(searcher.TT.data(), searcher.TT.bytes())
+              << " (" << searcher.TT.allocationInfo() << ")" << std::endl;
+    total += searcher.TT.bytes();
+
+    size_t threadsTotal = 0;
+    for (auto& thread : searcher.threads) {
+        Search::ThreadFootprint f = thread->footprint();
+        std::cout << "info string memory thread " << thread->threadId << " histories " << f.histories
+                  << " huge " << huge(thread->histories.get(), f.histories) << " accumulators " << f.accumulators
+                  << " huge " << huge(thread->accStack.data(), f.accumulators) << " stack " << f.searchStack
+                  << " bucketcache " << f.bucketCache << " evalcache " << f.evalCache << " other " << f.other
+                  << " total " << f.total() << std::endl;
+        threadsTotal += f.total();
+    }
+    std::cout << "info string memory threads " << searcher.threads.size() << " total " << threadsTotal << std::endl;
+    total += threadsTotal;
+
+    // The network is embedded in the binary and mapped read only from it
+    std::cout << "info string memory network " << sizeof(Network) << " huge " << huge(permutedNet, sizeof(Network))
+              << " (embedded)" << std::endl;
+    total += sizeof(Network);
+
+    size_t lookups = lookupBytes() + Search::lmrTableBytes();
+    std::cout << "info string memory lookups " << lookups << " (chess.hpp attack tables not counted)" << std::endl;
+    total += lookups;
+
+    std::cout << "info string memory total " << total << " (" << total / (1024 * 1024) << "MB)" << std::endl;
+}
+
+// NPS scaling with the current ThreadBinding
+// threadbench [max threads] [ms per position]
+void threadBench(Searcher& searcher, char* str) {
+    std::istringstream iss(str + strlen("threadbench"));
+    int maxThreads = std::max<int>(std::thread::hardware_concurrency(), 1);
+    int64_t ms = 1000;
+    iss >> maxThreads >> ms;
+    // A movetime of 0 would search without limit
+    maxThreads = std::max(maxThreads, 1);
+    ms = std::max<int64_t>(ms, 1);
+    constexpr int POSITIONS = 8;
+
+    searcher.waitForSearchFinished();
+    size_t previousThreads = searcher.threads.size();
+    searcher.printInfo = false;
+
+    std::vector<int> counts;
+    for (int t = 1; t < maxThreads; t *= 2)
+        counts.push_back(t);
+    counts.push_back(maxThreads);
+
+    std::cout << "Thread bench with binding " << searcher.threadBinding << ", " << ms << "ms on " << POSITIONS
+              << " positions" << std::endl;
+    double baseNps = 0;
+    for (int count : counts) {
+        searcher.initialize(count);
+        searcher.reset();
+        uint64_t nodes = 0;
+        int64_t totalMS = 0;
+        for (int i = 0; i < POSITIONS; i++) {
+            Board board(BENCH_FENS[i]);
+            Search::Limit limit = Search::Limit();
+            limit.movetime = ms;
+            limit.start();
+            TimeLimit timer = TimeLimit();
+            timer.start();
+            searcher.startSearching(board, limit);
+            searcher.waitForSearchFinished();
+            totalMS += timer.elapsed();
+            nodes += searcher.nodeCount();
+        }
+        double nps = nodes * 1000.0 / std::max<int64_t>(totalMS, 1);
+        if (count == 1)
+            baseNps = nps;
+        std::cout << "Threads: " << count << " NPS: " << static_cast<int64_t>(nps)
+                  << " Speedup: " << nps / baseNps << std::endl;
+    }
 
+    searcher.initialize(previousThreads);
+    searcher.reset();
     searcher.printInfo = true;
 }
 
+// SEE on every legal move of the bench positions, with pins computed per call
+// against pins computed once per position as the search does
+// seebench [iterations]
+void seeBench(char* str) {
+    std::istringstream iss(str + strlen("seebench"));
+    int iterations = 2000;
+    iss >> iterations;
+
+    std::vector<std::pair<Board, Movelist>> positions;
+    size_t calls = 0;
+    for (auto fen : BENCH_FENS) {
+        Board board(fen);
+        Movelist moves;
+        movegen::legalmoves(moves, board);
+        calls += moves.size();
+        positions.emplace_back(board, moves);
+    }
+    calls *= iterations;
+
+    auto run = [&](bool cached) {
+        TimeLimit timer = TimeLimit();
+        timer.start();
+        uint64_t passed = 0;
+        for (int i = 0; i < iterations; i++) {
+            for (auto& [board, moves] : positions) {
+                StateInfo pins = cached ? calculatePins(board) : StateInfo();
+                for (Move move : moves)
+                    passed += cached ? SEE(board, move, 0, pins) : SEE(board, move, 0);
+            }
+        }
+        int64_t ms = std::max<int64_t>(timer.elapsed(), 1);
+        std::cout << (cached ? "Cached pins: " : "Per call pins: ") << ms << "ms "
+                  << calls * 1000 / ms << " calls/s (" << passed << " passed)" << std::endl;
+        return ms;
+    };
+
+    std::cout << "SEE bench on " << calls << " calls" << std::endl;
+    int64_t perCall = run(false);
+    int64_t cached = run(true);
+    std::cout << "Speedup: " << (double)perCall / cached << std::endl;
+}
+
+// EPD lines only carry the first four FEN fields, clocks default to 0 1
+static std::string EpdToFen(const std::string& line, std::string& operations) {
+    std::istringstream iss(line);
+    std::vector<std::string> fields;
+    std::string token;
+    while (fields.size() < 6 && iss >> token)
+        fields.push_back(token);
+    if (fields.size() < 4)
+        return "";
+    std::string fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3];
+    bool clocks = fields.size() == 6 && std::all_of(fields[4].begin(), fields[4].end(), ::isdigit)
+                  && std::all_of(fields[5].begin(), fields[5].end(), ::isdigit);
+    if (clocks) {
+        fen += " " + fields[4] + " " + fields[5];
+        std::getline(iss, operations);
+    } else {
+        fen += " 0 1";
+        // Anything after the board fields is an EPD operation
+        size_t pos = 0;
+        for (int i = 0; i < 4; i++) {
+            pos = line.find_first_not_of(' ', pos);
+            pos = line.find(' ', pos);
+        }
+        operations = pos == std::string::npos ? "" : line.substr(pos);
+    }
+    size_t first = operations.find_first_not_of(' ');
+    operations = first == std::string::npos ? "" : operations.substr(first);
+    return fen;
+}
+
+// Analyses every position of an EPD or FEN file with many single thread searches at once.
+// Workers share the TT of the main searcher and print EPD lines as they finish
+// batch <file> [workers <n>] [depth <d>] [nodes <n>] [movetime <ms>]
+void batchAnalysis(Searcher& searcher, const std::string& args, bool chess960) {
+    std::istringstream iss(args);
+    std::string path, token;
+    iss >> path;
+    int workers = std::max<int>(std::thread::hardware_concurrency(), 1);
+    int64_t depth = 0, nodes = -1, movetime = 0;
+    while (iss >> token) {
+        if (token == "workers")
+            iss >> workers;
+        else if (token == "depth")
+            iss >> depth;
+        else if (token == "nodes")
+            iss >> nodes;
+        else if (token == "movetime")
+            iss >> movetime;
+    }
+    if (depth == 0 && nodes == -1 && movetime == 0)
+        depth = BENCH_DEPTH;
+
+    std::ifstream file(path);
+    if (!file) {
+        std::cout << "info string batch could not open " << path << std::endl;
+        return;
+    }
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(file, line)) {
+        line.erase(line.find_last_not_of(" \r\n") + 1);
+        if (!line.empty() && line[0] != '#')
+            lines.push_back(line);
+    }
+    workers = std::clamp<int>(workers, 1, std::max<size_t>(lines.size(), 1));
+
+    searcher.waitForSearchFinished();
+    std::vector<std::unique_ptr<Searcher>> searchers;
+    for (int i = 0; i < workers; i++) {
+        auto worker = std::make_unique<Searcher>(searcher.TT);
+        worker->printInfo = false;
+        worker->ttEvalStores = searcher.ttEvalStores;
+        worker->threadBinding = searcher.threadBinding;
+        // Every worker is thread 0 of its own searcher, bind it as the i-th thread
+        worker->bindingOffset = i;
+        worker->initialize(1);
+        searchers.push_back(std::move(worker));
+    }
+
+    std::atomic<size_t> next = 0;
+    std::atomic<uint64_t> totalNodes = 0;
+    std::atomic<size_t> analysed = 0;
+    std::mutex outputMutex;
+    TimeLimit timer = TimeLimit();
+    timer.start();
+
+    auto analyse = [&](Searcher& worker) {
+        for (size_t i = next++; i < lines.size(); i = next++) {
+            // Workers do not age the shared TT, one generation passes per round of positions
+            if (i > 0 && i % workers == 0)
+                searcher.TT.incAge();
+            std::string operations;
+            std::string fen = EpdToFen(lines[i], operations);
+            if (fen.empty())
+                continue;
+            Board board;
+            board.set960(chess960);
+            board.setFen(fen);
+
+            Search::Limit limit = Search::Limit();
+            limit.depth = depth;
+            limit.maxnodes = nodes;
+            limit.movetime = movetime;
+            limit.start();
+            worker.startSearching(board, limit);
+            worker.waitForSearchFinished();
+
+            Search::ThreadInfo& thread = *worker.threads[0];
+            int score = worker.bestScore;
+            uint64_t searched = worker.nodeCount();
+            totalNodes += searched;
+            analysed++;
+
+            std::ostringstream out;
+            out << board.getFen(false) << " ";
+            if (!operations.empty())
+                out << operations << " ";
+            if (!moveIsNull(thread.bestMove))
+                out << "bm " << uci::moveToSan(board, thread.bestMove) << "; ";
+            if (score >= FOUND_MATE || score <= GETTING_MATED)
+                out << "dm " << (score > 0 ? (MATE - score + 1) / 2 : -(MATE + score) / 2) << "; ";
+            else
+                out << "ce " << (searcher.normalizeEval ? scaleEval(score, board) : score) << "; ";
+            out << "acd " << thread.completed << "; acn " << searched << ";";
+
+            std::lock_guard lock{outputMutex};
+            std::cout << out.str() << std::endl;
+        }
+    };
+    std::vector<std::thread> drivers;
+    for (auto& worker : searchers)
+        drivers.emplace_back(analyse, std::ref(*worker));
+    for (auto& driver : drivers)
+        driver.join();
+
+    for (auto& worker : searchers)
+        worker->exit();
+
+    int64_t ms = std::max<int64_t>(timer.elapsed(), 1);
+    std::cout << "info string batch " << analysed << " positions with " << workers << " workers in " << ms
+              << "ms, " << static_cast<int64_t>(analysed * 3600000.0 / ms) << " positions/hour, "
+              << totalNodes * 1000 / ms << " nps" << std::endl;
+}
+
 int main(int agrc, char* argv[]) {
     // r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1
     initLookups();
@@ -368,6 +745,14 @@ int main(int agrc, char* argv[]) {
             searcher.exit();
             return 0;
         }
+        if (arg == "batch") {
+            std::string args;
+            for (int i = 2; i < agrc; i++)
+                args += std::string(argv[i]) + " ";
+            batchAnalysis(searcher, args, false);
+            searcher.exit();
+            return 0;
+        }
         if (arg.substr(0, 7) == "genfens"){
             handleGenfens(searcher, arg);
             if (agrc > 2) {
@@ -386,14 +771,31 @@ int main(int agrc, char* argv[]) {
 
     char str[INPUT_SIZE];
     while (GetInput(str)) {
+        // HashInput collides with stop
+        if (BeginsWith(str, "loadhash")) {
+            UCILoadHash(searcher, str);
+            continue;
+        }
+        // HashInput collides with ucinewgame
+        if (BeginsWith(str, "memory")) {
+            UCIMemory(searcher);
+            continue;
+        }
+        // HashInput collides with setoption
+        if (BeginsWith(str, "stats")) {
+            searcher.waitForSearchFinished();
+            searcher.printStats();
+            continue;
+        }
         switch (HashInput(str)) {
             case GO         : UCIGo(searcher, board, str);                break;
             case UCI        : UCIInfo();                                  break;
-            case ISREADY    : std::cout << "readyok" << std::endl;        break;
+            case ISREADY    : UCIIsReady(searcher);                       break;
             case POSITION   : UCIPosition(board, str);                    break;
             case SETOPTION  : UCISetOption(searcher, board, str);         break;
-            case UCINEWGAME : searcher.reset();                           break;
+            case UCINEWGAME : searcher.newGame();                         break;
             case STOP       : searcher.stopSearching();                   break;
+            case PONDERHIT  : searcher.ponderhit();                       break;
             case QUIT       : searcher.exit();                            return 0;
 
             // Non Standard
@@ -405,6 +807,10 @@ int main(int agrc, char* argv[]) {
             case CONFIG     : printOBConfig();                            break;
             case QUANT      : quantise_raw();                             break;
             case NETSCALE   : network.computeScale("data/lichess.book");  break;
+            case SAVEHASH   : UCISaveHash(searcher, str);                 break;
+            case THREADBENCH: threadBench(searcher, str);                 break;
+            case SEEBENCH   : seeBench(str);                              break;
+            case BATCH      : batchAnalysis(searcher, str + strlen("batch"), board.chess960()); break;
 
         }
     }
@@ -7,6 +7,138 @@
 // Based off Weiss
 using enum MPStage;
 
+template <typename Add, typename T>
+static void addMoves(Add& add, Bitboard pieces, T targets) {
+    while (pieces) {
+        const Square from = pieces.pop();
+        Bitboard to = targets(from);
+        while (to)
+            add(Move::make<Move::NORMAL>(from, to.pop()));
+    }
+}
+
+template <std::uint16_t type, typename Add>
+static void addPawnMoves(Add& add, Bitboard to, Direction back) {
+    while (to) {
+        const Square sq = to.pop();
+        if constexpr (type == Move::PROMOTION) {
+            add(Move::make<Move::PROMOTION>(sq + back, sq, PieceType::QUEEN));
+            add(Move::make<Move::PROMOTION>(sq + back, sq, PieceType::ROOK));
+            add(Move::make<Move::PROMOTION>(sq + back, sq, PieceType::BISHOP));
+            add(Move::make<Move::PROMOTION>(sq + back, sq, PieceType::KNIGHT));
+        } else
+            add(Move::make<type>(sq + back, sq));
+    }
+}
+
+// Pseudo legal generation for positions that are not in check. Moves come out in the same
+// order movegen::legalmoves would produce them, with the illegal ones still in between, so
+// selectHighest can drop those and see exactly the legal list
+template <Color::underlying c, movegen::MoveGenType mt>
+static void pseudoLegalMoves(Movelist& moves, const Board& board) {
+    constexpr Direction UP = make_direction(Direction::NORTH, c);
+    constexpr Direction DOWN = make_direction(Direction::SOUTH, c);
+    constexpr Direction DOWN_LEFT = make_direction(Direction::SOUTH_WEST, c);
+    constexpr Direction DOWN_RIGHT = make_direction(Direction::SOUTH_EAST, c);
+    constexpr Direction UP_LEFT = make_direction(Direction::NORTH_WEST, c);
+    constexpr Direction UP_RIGHT = make_direction(Direction::NORTH_EAST, c);
+    constexpr Bitboard PROMO_RANK = Rank::rank(Rank::RANK_8, c).bb();
+    constexpr Bitboard DOUBLE_PUSH_RANK = Rank::rank(Rank::RANK_3, c).bb();
+    constexpr bool NOISY = mt != movegen::MoveGenType::QUIET;
+    constexpr bool QUIET = mt != movegen::MoveGenType::CAPTURE;
+
+    moves.clear();
+    auto add = [&](Move move) { moves.add(move); };
+    const Bitboard occ = board.occ();
+    const Bitboard them = board.us(~c);
+    Bitboard targets;
+    if constexpr (mt == movegen::MoveGenType::CAPTURE)
+        targets = them;
+    else if constexpr (mt == movegen::MoveGenType::QUIET)
+        targets = ~occ;
+    else
+        targets = ~board.us(c);
+
+    const Square king = board.kingSq(c);
+    addMoves(add, Bitboard::fromSquare(king), [&](Square sq) { return attacks::king(sq) & targets; });
+
+    if constexpr (QUIET) {
+        Board::CastlingRights rights = board.castlingRights();
+        Bitboard rooks;
+        if (Square::back_rank(king, c)) {
+            for (const auto side : {Board::CastlingRights::Side::KING_SIDE, Board::CastlingRights::Side::QUEEN_SIDE}) {
+                if (rights.has(c, side) && !(occ & board.getCastlingPath(c, side == Board::CastlingRights::Side::KING_SIDE)))
+                    rooks |= Bitboard::fromSquare(Square(rights.getRookFile(c, side), king.rank()));
+            }
+        }
+        while (rooks)
+            add(Move::make<Move::CASTLING>(king, rooks.pop()));
+    }
+
+    const Bitboard pawns = board.pieces(PieceType::PAWN, c);
+    const Bitboard left = attacks::shift<UP_LEFT>(pawns) & them;
+    const Bitboard right = attacks::shift<UP_RIGHT>(pawns) & them;
+    const Bitboard single = attacks::shift<UP>(pawns) & ~occ;
+    const Bitboard twice = attacks::shift<UP>(single & DOUBLE_PUSH_RANK) & ~occ;
+
+    if constexpr (NOISY) {
+        addPawnMoves<Move::PROMOTION>(add, left & PROMO_RANK, DOWN_RIGHT);
+        addPawnMoves<Move::PROMOTION>(add, right & PROMO_RANK, DOWN_LEFT);
+    }
+    if constexpr (QUIET)
+        addPawnMoves<Move::PROMOTION>(add, single & PROMO_RANK, DOWN);
+    if constexpr (NOISY) {
+        addPawnMoves<Move::NORMAL>(add, left & ~PROMO_RANK, DOWN_RIGHT);
+        addPawnMoves<Move::NORMAL>(add, right & ~PROMO_RANK, DOWN_LEFT);
+    }
+    if constexpr (QUIET) {
+        addPawnMoves<Move::NORMAL>(add, single & ~PROMO_RANK, DOWN);
+        Bitboard to = twice;
+        while (to) {
+            const Square sq = to.pop();
+            add(Move::make<Move::NORMAL>(sq + DOWN + DOWN, sq));
+        }
+    }
+    if constexpr (NOISY) {
+        const Square ep = board.enpassantSq();
+        if (ep != Square::NO_SQ) {
+            Bitboard from = attacks::pawn(~c, ep) & pawns;
+            while (from)
+                add(Move::make<Move::ENPASSANT>(from.pop(), ep));
+        }
+    }
+
+    addMoves(add, board.pieces(PieceType::KNIGHT, c), [&](Square sq) { return attacks::knight(sq) & targets; });
+    addMoves(add, board.pieces(PieceType::BISHOP, c), [&](Square sq) { return attacks::bishop(sq, occ) & targets; });
+    addMoves(add, board.pieces(PieceType::ROOK, c), [&](Square sq) { return attacks::rook(sq, occ) & targets; });
+    addMoves(add, board.pieces(PieceType::QUEEN, c), [&](Square sq) { return attacks::queen(sq, occ) & targets; });
+}
+
+void MovePicker::generate(movegen::MoveGenType mt) {
+    Board& board = thread->board;
+    if (!pseudoLegal) {
+        if (mt == movegen::MoveGenType::CAPTURE)
+            movegen::legalmoves<movegen::MoveGenType::CAPTURE>(movesList, board);
+        else
+            movegen::legalmoves<movegen::MoveGenType::QUIET>(movesList, board);
+        return;
+    }
+    bool white = board.sideToMove() == Color::WHITE;
+    if (mt == movegen::MoveGenType::CAPTURE)
+        white ? pseudoLegalMoves<Color::WHITE, movegen::MoveGenType::CAPTURE>(movesList, board)
+              : pseudoLegalMoves<Color::BLACK, movegen::MoveGenType::CAPTURE>(movesList, board);
+    else
+        white ? pseudoLegalMoves<Color::WHITE, movegen::MoveGenType::QUIET>(movesList, board)
+              : pseudoLegalMoves<Color::BLACK, movegen::MoveGenType::QUIET>(movesList, board);
+}
+
+// Only pinned pieces, king moves and en passant can leave the king in check when not already in check
+bool MovePicker::isLegalGenerated(Move move) {
+    if (move.from() != kingSq && move.typeOf() != Move::ENPASSANT && !pinned.check(move.from().index()))
+        return true;
+    return isLegalPseudoLegal(thread->board, move);
+}
+
 void MovePicker::scoreMoves(Movelist& moves) {
     for (auto& move : moves) {
         if (stage == GEN_NOISY || move.typeOf() == Move::CASTLING) {
@@ -47,43 +179,82 @@ void MovePicker::scoreMoves(Movelist& moves) {
     }
 }
 
+// Movelist cannot shrink, so the moves after index are copied into a new list
+static void eraseMove(Movelist& moves, int index) {
+    Movelist kept;
+    for (int i = 0; i < moves.size(); i++) {
+        if (i != index)
+            kept.add(moves[i]);
+    }
+    moves = kept;
+}
+
+// Pseudo legal moves are only checked when they are picked. An illegal best move is erased,
+// and so is an illegal move the swap would take out of currMove. The legal moves are then
+// picked and swapped exactly as in a legal list. Returns NO_MOVE if nothing legal is left
 Move MovePicker::selectHighest(Movelist& moves) {
-    int bestScore = moves[currMove].score();
-    uint32_t bestIndex = currMove;
-    for (uint32_t i = currMove; i < moves.size(); i++) {
-        if (moves[i].score() > bestScore) {
-            bestScore = moves[i].score();
-            bestIndex = i;
+    while (currMove < moves.size()) {
+        int bestScore = moves[currMove].score();
+        uint32_t bestIndex = currMove;
+        for (uint32_t i = currMove; i < moves.size(); i++) {
+            if (moves[i].score() > bestScore) {
+                bestScore = moves[i].score();
+                bestIndex = i;
+            }
         }
-    }
 
-    std::iter_swap(moves.begin() + bestIndex, moves.begin() + currMove);
-    return moves[currMove++];
+        if (pseudoLegal && !isLegalGenerated(moves[bestIndex])) {
+            eraseMove(moves, bestIndex);
+            continue;
+        }
+        if (pseudoLegal && bestIndex != currMove && !isLegalGenerated(moves[currMove])) {
+            eraseMove(moves, currMove);
+            continue;
+        }
+
+        std::iter_swap(moves.begin() + bestIndex, moves.begin() + currMove);
+        return moves[currMove++];
+    }
+    return Move(Move::NO_MOVE);
 }
 
 Move MovePicker::nextMove() {
     switch (stage) {
+        case ROOT:
+            // Lines of the last iteration first, then the other moves by nodes searched
+            if (currMove < thread->rootMoves.size())
+                return thread->rootMoves[currMove++].move;
+            return Move(Move::NO_MOVE);
+
         case TTMOVE:
             ++stage;
             // Only return ttMove if in QS if we're in check or if its a capture
-            if (isLegal(thread->board, ttMove) &&
-                (!isQS || thread->board.isCapture(ttMove) ||
-                 thread->board.inCheck())) {
-                return ttMove;
-            }
+            thread->moveValidations += !moveIsNull(ttMove);
+            if (isLegal(thread->board, ttMove)) {
+                if (!isQS || thread->board.isCapture(ttMove) || thread->board.inCheck())
+                    return ttMove;
+            } else if (!moveIsNull(ttMove))
+                thread->ttStats.corrupt++;
         case GEN_NOISY:
-            movegen::legalmoves<movegen::MoveGenType::CAPTURE>(movesList,
-                                                               thread->board);
+            pseudoLegal = !thread->board.inCheck();
+            if (pseudoLegal) {
+                Color stm = thread->board.sideToMove();
+                kingSq = thread->board.kingSq(stm);
+                pinned = thread->pins(ss).kingBlockers[(int)stm] & thread->board.us(stm);
+            }
+            generate(movegen::MoveGenType::CAPTURE);
             scoreMoves(movesList);
             ++stage;
 
         case NOISY_GOOD:
             while (currMove < movesList.size()) {
                 Move move = selectHighest(movesList);
+                if (moveIsNull(move))
+                    break;
                 if (move == ttMove) {
                     continue;
                 }
-                if (!SEE(thread->board, move, -move.score() / 4 + 15))
+                if (!SEE(thread->board, move, -move.score() / 4 + 15, thread->pins(ss)))
                     badNoises.add(move);
                 else
                     return move;
@@ -92,16 +263,22 @@ Move MovePicker::nextMove() {
 
         case KILLER:
             ++stage;
-            if (ss->killer != ttMove && !isQS &&
-                isLegal(thread->board, ss->killer))
-                return ss->killer;
+            if (ss->killer != ttMove && !isQS && !moveIsNull(ss->killer)) {
+                thread->moveValidations++;
+                if (isLegal(thread->board, ss->killer))
+                    return ss->killer;
+            }
 
         case GEN_QUIET:
             movesList.clear();
             currMove = 0;
             if (thread->board.inCheck() || !isQS) {
-                movegen::legalmoves<movegen::MoveGenType::QUIET>(movesList,
-                                                                 thread->board);
+                generate(movegen::MoveGenType::QUIET);
+                const std::array<Bitboard, 7>& threats = thread->threats(ss);
+                pawnThreats = threats[0];
+                knightThreats = threats[1];
+                bishopThreats = threats[2];
+                rookThreats = threats[3];
                 scoreMoves(movesList);
             }
             ++stage;
@@ -109,6 +286,8 @@ Move MovePicker::nextMove() {
         case QUIET:
             while (currMove < movesList.size()) {
                 Move move = selectHighest(movesList);
+                if (moveIsNull(move))
+                    break;
                 if (move == ttMove)
                     continue;
                 return move;
@@ -6,7 +6,8 @@
 #include "search.h"
 #include "util.h"
 
-enum class MPStage { TTMOVE, GEN_NOISY, NOISY_GOOD, KILLER, GEN_QUIET, QUIET, BAD_NOISY };
+// ROOT replaces the other stages at the root once RootMoves has an order
+enum class MPStage { ROOT, TTMOVE, GEN_NOISY, NOISY_GOOD, KILLER, GEN_QUIET, QUIET, BAD_NOISY };
 
 inline MPStage operator++(MPStage& stage) {
     stage = static_cast<MPStage>(static_cast<int>(stage) + 1);
@@ -23,7 +24,13 @@ struct MovePicker {
         int currMove;
         bool isQS;
 
-        // Threats
+        // Outside of check, moves are generated pseudo legally and checked when picked, only
+        // moves of pinned pieces, the king and en passant need a full check
+        bool pseudoLegal;
+        Bitboard pinned;
+        Square kingSq;
+
+        // Threats, loaded when quiets are scored
         Bitboard pawnThreats;
         Bitboard knightThreats;
         Bitboard bishopThreats;
@@ -36,13 +43,12 @@ struct MovePicker {
             isQS = qs;
             stage = MPStage::TTMOVE;
             currMove = 0;
-            pawnThreats = ss->threats[0];
-            knightThreats = ss->threats[1];
-            bishopThreats = ss->threats[2];
-            rookThreats = ss->threats[3];
+            pseudoLegal = false;
         }
 
         Move nextMove();
+        void generate(movegen::MoveGenType mt);
+        bool isLegalGenerated(Move move);
         void scoreMoves(Movelist& moves);
         Move selectHighest(Movelist& moves);
 };
@@ -275,6 +275,17 @@ void NNUE::computeScale(const std::string& filename) {
     file.close();
 }
 
+// Identifies the embedded network, used to reject TT snapshots built against a different one
+uint64_t networkHash() {
+    static uint64_t hash = [] {
+        const uint64_t* words = reinterpret_cast<const uint64_t*>(permutedNet);
+        uint64_t h = sizeof(Network);
+        for (size_t i = 0; i < sizeof(Network) / sizeof(uint64_t); i++)
+            h = murmurHash3(h ^ words[i]);
+        return h;
+    }();
+    return hash;
+}
 
 // ------ Accumulator -------
 
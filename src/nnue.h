@@ -45,6 +45,7 @@ struct Network {
 };
 
 void quantise_raw();
+uint64_t networkHash();
 
 struct BucketCacheEntry {
     std::array<int16_t, L1_SIZE> features;
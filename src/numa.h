@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+// Minimal NUMA helpers read straight from sysfs so we don't depend on libnuma
+namespace NUMA {
+
+    // Parses kernel list strings such as "0-3,8-11"
+    inline std::vector<int> parseList(const std::string& list) {
+        std::vector<int> result;
+        size_t pos = 0;
+        while (pos < list.size()) {
+            size_t end = list.find(',', pos);
+            if (end == std::string::npos)
+                end = list.size();
+            std::string range = list.substr(pos, end - pos);
+            size_t dash = range.find('-');
+            try {
+                int first = std::stoi(range.substr(0, dash));
+                int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+                for (int i = first; i <= last; i++)
+                    result.push_back(i);
+            } catch (...) {
+            }
+            pos = end + 1;
+        }
+        return result;
+    }
+
+    inline std::vector<int> readList(const std::string& path) {
+        std::ifstream file(path);
+        std::string line;
+        if (!std::getline(file, line))
+            return {};
+        return parseList(line);
+    }
+
+    // Online node ids, always at least node 0
+    inline std::vector<int> nodes() {
+        std::vector<int> n = readList("/sys/devices/system/node/online");
+        return n.empty() ? std::vector<int>{0} : n;
+    }
+
+    inline std::vector<int> cpus(int node) {
+        return readList("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    }
+
+    // CPUs a search thread should be pinned to for a ThreadBinding mode, empty for no pinning
+    //   none:    no pinning
+    //   compact: one CPU per thread, filling node 0 before node 1
+    //   scatter: threads round robin over the nodes, each pinned to all CPUs of its node
+    //   list:    like scatter but only over the listed nodes, e.g. "0,2" or "1-3"
+    inline std::vector<int> bindingCpus(const std::string& mode, int threadId) {
+        if (mode.empty() || mode == "none")
+            return {};
+        if (mode == "compact") {
+            std::vector<int> all;
+            for (int node : nodes()) {
+                std::vector<int> nodeCpus = cpus(node);
+                all.insert(all.end(), nodeCpus.begin(), nodeCpus.end());
+            }
+            if (all.empty())
+                return {};
+            return {all[threadId % all.size()]};
+        }
+        std::vector<int> targets = mode == "scatter" ? nodes() : parseList(mode);
+        if (targets.empty())
+            return {};
+        return cpus(targets[threadId % targets.size()]);
+    }
+
+    // Pins the calling thread to the given CPUs
+    inline bool bindThread(const std::vector<int>& cpuList) {
+#if defined(__linux__)
+        if (cpuList.empty())
+            return false;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpuList)
+            if (cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+        return false;
+#endif
+    }
+
+    // Spread the pages of a region round robin over all nodes. Only affects pages that
+    // have not been touched yet, and ptr must be page aligned
+    inline bool interleave(void* ptr, size_t bytes) {
+#if defined(__linux__) && defined(SYS_mbind)
+        std::vector<int> online = nodes();
+        if (online.size() < 2)
+            return false;
+        constexpr int MPOL_INTERLEAVE = 3;
+        uint64_t mask[16] = {};
+        for (int node : online)
+            if (node < 1024)
+                mask[node / 64] |= 1ULL << (node % 64);
+        return syscall(SYS_mbind, ptr, bytes, MPOL_INTERLEAVE, mask, 1024 + 1, 0) == 0;
+#else
+        return false;
+#endif
+    }
+}
@@ -211,7 +211,12 @@ namespace Search {
     bool isMateScore(int score) {
         return std::abs(score) >= FOUND_MATE;
     }
-    int evaluate(Board& board, Stack* ss, InputBucketCache& bucketCache) {
+    int evaluate(Board& board, Stack* ss, InputBucketCache& bucketCache, EvalCache& evalCache) {
+        // On a hit the accumulator stays lazy, children catch up from the last computed one
+        int cached;
+        if (evalCache.probe(board.hash(), cached))
+            return cached;
+
         int materialOffset = MAT_SCALE_PAWN() * board.pieces(PieceType::PAWN).count() + MAT_SCALE_KNIGHT() * board.pieces(PieceType::KNIGHT).count() + 
                             MAT_SCALE_BISHOP() * board.pieces(PieceType::BISHOP).count() + MAT_SCALE_ROOK() * board.pieces(PieceType::ROOK).count() + 
                             MAT_SCALE_QUEEN() * board.pieces(PieceType::QUEEN).count();
@@ -244,8 +249,14 @@ namespace Search {
         int eval = network.inference(board, *ss->accumulator);
 
         eval = eval * (MAT_SCALE_BASE() + materialOffset) / 32768; // Calvin yoink
-        return std::clamp(eval, GETTING_MATED + 1, FOUND_MATE - 1);
+        eval = std::clamp(eval, GETTING_MATED + 1, FOUND_MATE - 1);
+        evalCache.store(board.hash(), eval);
+        return eval;
+    }
+    size_t lmrTableBytes() {
+        return sizeof(lmrTable) + sizeof(factoredLmrTable);
     }
+
     void fillLmr() {
         // https://www.chessprogramming.org/Late_Move_Reductions
         // Maybe its possible to optimize a + log(x)log(y)/b with some gradient descent tuning method
@@ -283,18 +294,13 @@ namespace Search {
         if (thread.stopped)
             return 0;
 
-        if (thread.type == ThreadType::MAIN && 
-            ((thread.loadNodes() & 2047) == 0) && limit.outOfTime() && thread.rootDepth != 1) {
-            thread.stopped = true;
-            return 0;
-        }
         if (thread.type == ThreadType::MAIN && limit.outOfNodes(thread.loadNodes())) {
             thread.stopped = true;
             return 0;
         }
         if (ply >= MAX_PLY - 1) {
             return (ply >= MAX_PLY - 1 && !thread.board.inCheck())
-                           ? evaluate(thread.board, ss, thread.bucketCache)
+                           ? evaluate(thread.board, ss, thread.bucketCache, thread.evalCache)
                            : 0;
         }
 
@@ -305,7 +311,7 @@ namespace Search {
         ProbedTTEntry ttData = {};
         bool ttHit = false;
 
-        ttHit = thread.searcher.TT.probe(thread.board.hash(), ply, ttData);
+        ttHit = thread.searcher.TT.probe(thread.board.hash(), ply, ttData, thread.ttStats);
         
         bool ttPV = isPV || (ttHit && ttData.pv);
 
@@ -325,11 +331,11 @@ namespace Search {
         } else {
             rawStaticEval = ttHit && ttData.staticEval != EVAL_NONE && !isMateScore(ttData.staticEval)
                                 ? ttData.staticEval
-                                : evaluate(thread.board, ss, thread.bucketCache);
+                                : evaluate(thread.board, ss, thread.bucketCache, thread.evalCache);
             eval = thread.correctStaticEval(ss, thread.board, rawStaticEval);
             
-            if (!ttHit)
-                thread.searcher.TT.store(thread.board.hash(), Move::NO_MOVE, -EVAL_INF, rawStaticEval, TTFlag::NO_BOUND, 0, ply, ttPV);
+            if (!ttHit && thread.searcher.ttEvalStores)
+                thread.searcher.TT.store(thread.board.hash(), Move::NO_MOVE, -EVAL_INF, rawStaticEval, TTFlag::NO_BOUND, 0, ply, ttPV, thread.ttStats);
         }
 
         if (eval >= beta)
@@ -342,8 +348,10 @@ namespace Search {
         Move qBestMove = Move::NO_MOVE;
         uint8_t ttFlag = TTFlag::FAIL_LOW;
 
-        // Calculuate Threats
-        ss->threats = calculateThreats(thread.board);
+        // Threats and pins are calculated lazily
+        ss->threatsReady = false;
+        ss->pinsReady = false;
+        thread.threatNodes++;
         
         // This will do evasions as well
         Move move;
@@ -356,15 +364,20 @@ namespace Search {
                     break;
             }
             // SEE Pruning
-            if (bestScore > GETTING_MATED && !SEE(thread.board, move, QS_SEE_MARGIN()))
+            if (bestScore > GETTING_MATED && !SEE(thread.board, move, QS_SEE_MARGIN(), thread.pins(ss)))
                 continue;
 
-            thread.searcher.TT.prefetch(prefetchKey(thread.board, move));
+            uint64_t childKey = hashAfter(thread.board, move);
+            thread.searcher.TT.prefetch(childKey);
+            thread.evalCache.prefetch(childKey);
             if (thread.board.isCapture(move))
                 ss->toSquare = move.to();
             MakeMove(thread.board, move, thread.bucketCache, ss);
+#ifdef PREFETCH_VERIFY
+            thread.ttStats.prefetchMismatches += thread.board.hash() != childKey;
+#endif
 
-            thread.nodes.fetch_add(1, std::memory_order::relaxed);
+            thread.addNode();
             moveCount++;
             int score = -qsearch<isPV>(ply + 1, -beta, -alpha, ss + 1, thread, limit);
 
@@ -388,7 +401,7 @@ namespace Search {
         if (!moveCount && inCheck)
             return -MATE + ply;
 
-        thread.searcher.TT.store(thread.board.hash(), qBestMove, bestScore, rawStaticEval, ttFlag, 0, ply, ttPV);
+        thread.searcher.TT.store(thread.board.hash(), qBestMove, bestScore, rawStaticEval, ttFlag, 0, ply, ttPV, thread.ttStats);
 
         return bestScore;
     }
@@ -399,7 +412,7 @@ namespace Search {
         ss->ply = ply;
 
         if (isPV)
-            ss->pv.length = 0;
+            thread.pvTable[ply].length = 0;
 
         if (thread.stopped)
             return 0;
@@ -408,11 +421,6 @@ namespace Search {
             return qsearch<isPV>(ply, alpha, beta, ss, thread, limit);
         }
 
-        if (thread.type == ThreadType::MAIN && 
-            ((thread.loadNodes() & 2047) == 0) && limit.outOfTime() && thread.rootDepth != 1) {
-            thread.stopped = true;
-            return 0;
-        }
         if (thread.type == ThreadType::MAIN && limit.outOfNodes(thread.loadNodes())) {
             thread.stopped = true;
             return 0;
@@ -426,7 +434,7 @@ namespace Search {
 
         if (ply >= MAX_PLY - 1) {
             return (ply >= MAX_PLY - 1 && !thread.board.inCheck())
-                           ? evaluate(thread.board, ss, thread.bucketCache)
+                           ? evaluate(thread.board, ss, thread.bucketCache, thread.evalCache)
                            : 0;
         }
 
@@ -436,7 +444,7 @@ namespace Search {
         bool ttHit = false;
 
         if (moveIsNull(ss->excluded)) {
-            ttHit = thread.searcher.TT.probe(thread.board.hash(), ply, ttData);
+            ttHit = thread.searcher.TT.probe(thread.board.hash(), ply, ttData, thread.ttStats);
         }
 
         bool ttPV = isPV || (ttHit && ttData.pv);
@@ -466,12 +474,12 @@ namespace Search {
         } else {
             rawStaticEval = ttHit && ttData.staticEval != EVAL_NONE && !isMateScore(ttData.staticEval)
                                 ? ttData.staticEval
-                                : evaluate(thread.board, ss, thread.bucketCache);
+                                : evaluate(thread.board, ss, thread.bucketCache, thread.evalCache);
             ss->eval = ss->staticEval = thread.correctStaticEval(ss, thread.board, rawStaticEval);
             corrplexity = rawStaticEval - ss->staticEval;
 
-            if (!ttHit)
-                thread.searcher.TT.store(thread.board.hash(), Move::NO_MOVE, -EVAL_INF, rawStaticEval, TTFlag::NO_BOUND, 0, ply, ttPV);
+            if (!ttHit && thread.searcher.ttEvalStores)
+                thread.searcher.TT.store(thread.board.hash(), Move::NO_MOVE, -EVAL_INF, rawStaticEval, TTFlag::NO_BOUND, 0, ply, ttPV, thread.ttStats);
         }
         // Improving heurstic
         // We are better than 2 plies ago
@@ -513,8 +521,7 @@ namespace Search {
                 ss->conthist = nullptr;
                 ss->contCorrhist = nullptr;
 
-                // Null move prefetch is just flip color
-                thread.searcher.TT.prefetch(thread.board.hash() ^ Zobrist::sideToMove());
+                thread.searcher.TT.prefetch(hashAfter(thread.board, Move(Move::NULL_MOVE)));
 
                 MakeMove(thread.board, Move(Move::NULL_MOVE), thread.bucketCache, ss);
                 int nmpScore =
@@ -552,13 +559,17 @@ namespace Search {
             ttData.score >= spcBeta && !isMateScore(ttData.score) && !isMateScore(beta))
             return spcBeta;
 
-        // Calculuate Threats
-        ss->threats = calculateThreats(thread.board);
+        // Threats and pins are calculated lazily
+        ss->threatsReady = false;
+        ss->pinsReady = false;
+        thread.threatNodes++;
 
 
         Move bestMove = Move::NO_MOVE;
         Move move;
         MovePicker picker = MovePicker(&thread, ss, ttData.move, false);
+        if (root && thread.rootMoves.ordered())
+            picker.stage = MPStage::ROOT;
 
         Movelist seenQuiets;
         Movelist seenCaptures;
@@ -572,6 +583,9 @@ namespace Search {
                 continue;
             if (isQuiet && skipQuiets)
                 continue;
+            // Earlier MultiPV lines and moves outside go searchmoves
+            if (root && thread.rootMoves.skip(move))
+                continue;
             if (isQuiet)
                 seenQuiets.add(move);
             else
@@ -608,7 +622,7 @@ namespace Search {
                 }
 
                 int seeMargin = isQuiet ? SEE_QUIET_SCALE() * lmrDepth - ss->historyScore / SEE_QUIET_HIST_DIVISOR() : SEE_NOISY_SCALE() * lmrDepth - ss->historyScore / SEE_NOISY_HIST_DIVISOR();
-                if (!SEE(thread.board, move, seeMargin))
+                if (!SEE(thread.board, move, seeMargin, thread.pins(ss)))
                     continue;
 
             }
@@ -652,11 +666,16 @@ namespace Search {
 
             uint64_t previousNodes = thread.loadNodes();
 
-            thread.searcher.TT.prefetch(prefetchKey(thread.board, move));
+            uint64_t childKey = hashAfter(thread.board, move);
+            thread.searcher.TT.prefetch(childKey);
+            thread.evalCache.prefetch(childKey);
 
             MakeMove(thread.board, move, thread.bucketCache, ss);
+#ifdef PREFETCH_VERIFY
+            thread.ttStats.prefetchMismatches += thread.board.hash() != childKey;
+#endif
             moveCount++;
-            thread.nodes.fetch_add(1, std::memory_order::relaxed);
+            thread.addNode();
 
             int newDepth = depth - 1 + extension;
             // Late Move Reduction
@@ -714,8 +733,8 @@ namespace Search {
             if (thread.stopped)
                 return 0;
 
-            if (root && thread.type == ThreadType::MAIN)
-                limit.updateNodes(move, thread.loadNodes() - previousNodes);
+            if (root)
+                thread.rootMoves.addNodes(move, thread.loadNodes() - previousNodes);
 
             if (score > bestScore) {
                 bestScore = score;
@@ -725,7 +744,7 @@ namespace Search {
                     ttFlag = TTFlag::EXACT;
                     alpha = score;
                     if (isPV) {
-                        ss->pv.update(move, (ss + 1)->pv);
+                        thread.pvTable[ply].update(move, thread.pvTable[ply + 1]);
                     }
                 }
             }
@@ -765,7 +784,9 @@ namespace Search {
         if (bestScore >= beta && !isMateScore(bestScore) && !isMateScore(alpha))
             bestScore = (bestScore * depth + beta) / (depth + 1);
 
-        if (moveIsNull(ss->excluded)) {
+        // Later MultiPV lines exclude the better moves, their result must not replace
+        // the root entry or teach correction history
+        if (moveIsNull(ss->excluded) && !(root && thread.rootMoves.pvIndex > 0)) {
             // Update correction history
             bool isBestQuiet = !thread.board.isCapture(bestMove);
             if (!inCheck && (isBestQuiet || moveIsNull(bestMove)) &&
@@ -777,7 +798,7 @@ namespace Search {
             }
 
             // Update TT
-            thread.searcher.TT.store(thread.board.hash(), bestMove, bestScore, rawStaticEval, ttFlag, depth, ply, ttPV);
+            thread.searcher.TT.store(thread.board.hash(), bestMove, bestScore, rawStaticEval, ttFlag, depth, ply, ttPV, thread.ttStats);
         }
 
         return bestScore;
@@ -794,15 +815,25 @@ namespace Search {
         int bmStability = 0;
         Move prevMove = Move::NO_MOVE;
 
+        // Time limits are ignored while pondering, on ponderhit the clock restarts
+        bool pondering = threadInfo.searcher.pondering;
+        auto stillPondering = [&]() {
+            if (pondering && !threadInfo.searcher.pondering) {
+                limit.timer = threadInfo.searcher.limit.timer;
+                pondering = false;
+            }
+            return pondering;
+        };
+
         for (int depth = 1; depth <= limit.depth; depth++) {
             auto aborted = [&](bool canSoft) {
                 if (threadInfo.stopped)
                     return true;
                 // Only check soft node limit outside of aspiration
                 if (isMain)
-                    return limit.outOfTime() || limit.outOfNodes(threadInfo.nodes) || (limit.softNodes(threadInfo.nodes) && canSoft);
+                    return (!stillPondering() && limit.outOfTime()) || limit.outOfNodes(threadInfo.loadNodes()) || (limit.softNodes(threadInfo.loadNodes()) && canSoft);
                 else
-                    return limit.softNodes(threadInfo.nodes) && canSoft;
+                    return limit.softNodes(threadInfo.loadNodes()) && canSoft;
             };
             threadInfo.rootDepth = depth;
             threadInfo.selDepth = 0;
@@ -816,45 +847,76 @@ namespace Search {
             ss->minorKey = resetMinorHash(threadInfo.board);
             ss->nonPawnKey[0] = resetNonPawnHash(threadInfo.board, Color::WHITE);
             ss->nonPawnKey[1] = resetNonPawnHash(threadInfo.board, Color::BLACK);
-            int eval = evaluate(threadInfo.board, ss, threadInfo.bucketCache);
+            int eval = evaluate(threadInfo.board, ss, threadInfo.bucketCache, threadInfo.evalCache);
 
-            if (limit.softNodes(threadInfo.nodes)){
+            if (limit.softNodes(threadInfo.loadNodes())){
                 break;
             }
             // Aspiration Windows
-            if (depth >= MIN_ASP_WINDOW_DEPTH()) {
-                int delta = INITIAL_ASP_WINDOW();
-                int alpha = std::max(lastScore - delta, -EVAL_INF);
-                int beta = std::min(lastScore + delta, EVAL_INF);
-                int aspDepth = depth;
-                while (!aborted(false)) {
-                    score = search<true>(std::max(aspDepth, 1), 0, alpha, beta, false, ss, threadInfo, limit);
-                    if (score <= alpha) {
-                        beta = (alpha + beta) / 2;
-                        alpha = std::max(alpha - delta, -EVAL_INF);
-                        aspDepth = depth;
-                    } else {
-                        if (score >= beta) {
-                            beta = std::min(beta + delta, EVAL_INF);
-                            aspDepth = std::max(aspDepth - 1, depth - 5);
-                        } else
-                            break;
+            auto aspiration = [&](int prevScore, bool window) {
+                int result = -EVAL_INF;
+                if (window && depth >= MIN_ASP_WINDOW_DEPTH()) {
+                    int delta = INITIAL_ASP_WINDOW();
+                    int alpha = std::max(prevScore - delta, -EVAL_INF);
+                    int beta = std::min(prevScore + delta, EVAL_INF);
+                    int aspDepth = depth;
+                    while (!aborted(false)) {
+                        result = search<true>(std::max(aspDepth, 1), 0, alpha, beta, false, ss, threadInfo, limit);
+                        if (result <= alpha) {
+                            beta = (alpha + beta) / 2;
+                            alpha = std::max(alpha - delta, -EVAL_INF);
+                            aspDepth = depth;
+                        } else {
+                            if (result >= beta) {
+                                beta = std::min(beta + delta, EVAL_INF);
+                                aspDepth = std::max(aspDepth - 1, depth - 5);
+                            } else
+                                break;
+                        }
+                        delta += delta * ASP_WIDENING_FACTOR() / 16;
                     }
-                    delta += delta * ASP_WIDENING_FACTOR() / 16;
+                } else
+                    result = search<true>(depth, 0, -EVAL_INF, EVAL_INF, false, ss, threadInfo, limit);
+                return result;
+            };
+
+            // MultiPV, line k is searched with the best moves of lines 0..k-1 excluded at the root.
+            // Helpers only search the first line
+            int lines = isMain ? std::clamp<int>(threadInfo.searcher.multiPV, 1, std::max<size_t>(threadInfo.rootMoves.size(), 1)) : 1;
+            PVList bestPV;
+            Move bestRootMove = Move::NO_MOVE;
+            threadInfo.rootMoves.startIteration();
+            for (int k = 0; k < lines; k++) {
+                threadInfo.rootMoves.pvIndex = k;
+                // Later lines are seeded with their own last score, with a full window when that
+                // is unknown (-EVAL_INF) or a mate score
+                int prevScore = k == 0 ? lastScore : threadInfo.rootMoves[k].previousScore;
+                int lineScore = aspiration(prevScore, k == 0 || !isMateScore(prevScore));
+                if (depth != 1 && aborted(false))
+                    break;
+                if (k == 0) {
+                    score = lineScore;
+                    bestPV = threadInfo.pvTable[0];
+                    bestRootMove = ss->bestMove;
                 }
-            } else
-                score = search<true>(depth, 0, -EVAL_INF, EVAL_INF, false, ss, threadInfo, limit);
+                threadInfo.rootMoves.pickLine(k, ss->bestMove, lineScore, threadInfo.pvTable[0]);
+            }
+            threadInfo.rootMoves.pvIndex = 0;
+            threadInfo.rootMoves.sortRest(lines);
             // ---------------------
             if (depth != 1 && aborted(false)) {
                 break;
             }
 
             lastScore = score;
-            lastPV = ss->pv;
+            lastPV = bestPV;
 
             // Save best scores
             threadInfo.completed = depth;
-            threadInfo.bestMove = ss->bestMove;
+            if (isMain && depth == 1)
+                threadInfo.searcher.firstDepthCompleted();
+            threadInfo.bestMove = bestRootMove;
+            threadInfo.ponderMove = lastPV.length > 1 ? lastPV.moves[1] : Move::NO_MOVE;
             threadInfo.bestRootScore = score;
 
             if (!isMain) {
@@ -862,6 +924,7 @@ namespace Search {
             }
 
             // Reporting
+            threadInfo.publishNodes();
             uint64_t nodecnt = threadInfo.searcher.nodeCount();
 
             std::stringstream pvss;           // String stream for the mainline
@@ -873,20 +936,36 @@ namespace Search {
             }
             if (threadInfo.searcher.printInfo) {
                 if (!PRETTY_PRINT) {
-                    std::cout << "info depth " << depth << " seldepth " << threadInfo.selDepth << " score ";
-                    if (score >= FOUND_MATE || score <= GETTING_MATED) {
-                        std::cout << "mate " << (score > 0 ? (MATE - score + 1) / 2 : -(MATE + score) / 2);
-                    } else {
-                        int s = threadInfo.searcher.normalizeEval ? scaleEval(score, threadInfo.board) : score; // Only scale if WDL enabled
-                        std::cout << "cp " << s;
-                        if (threadInfo.searcher.showWDL) {
-                            WDL wdl = computeWDL(score, threadInfo.board);
-                            std::cout << " wdl " << wdl.w << " " << wdl.d << " " << wdl.l;
+                    for (int k = 0; k < lines; k++) {
+                        int lineScore = lines > 1 ? threadInfo.rootMoves[k].score : score;
+                        const PVList& linePV = lines > 1 ? threadInfo.rootMoves[k].pv : lastPV;
+
+                        std::cout << "info depth " << depth << " seldepth " << threadInfo.selDepth;
+                        if (lines > 1)
+                            std::cout << " multipv " << k + 1;
+                        std::cout << " score ";
+                        if (lineScore >= FOUND_MATE || lineScore <= GETTING_MATED) {
+                            std::cout << "mate " << (lineScore > 0 ? (MATE - lineScore + 1) / 2 : -(MATE + lineScore) / 2);
+                        } else {
+                            int s = threadInfo.searcher.normalizeEval ? scaleEval(lineScore, threadInfo.board) : lineScore; // Only scale if WDL enabled
+                            std::cout << "cp " << s;
+                            if (threadInfo.searcher.showWDL) {
+                                WDL wdl = computeWDL(lineScore, threadInfo.board);
+                                std::cout << " wdl " << wdl.w << " " << wdl.d << " " << wdl.l;
+                            }
                         }
+                        std::cout << " hashfull " << threadInfo.searcher.TT.hashfull();
+                        std::cout << " nodes " << nodecnt << " nps " << nodecnt / (limit.timer.elapsed() + 1) * 1000 << " time " << limit.timer.elapsed() << " pv ";
+                        if (lines > 1) {
+                            Board lineBoard = threadInfo.board;
+                            for (uint32_t i = 0; i < linePV.length; i++) {
+                                std::cout << uci::moveToUci(linePV.moves[i], lineBoard.chess960()) << " ";
+                                lineBoard.makeMove(linePV.moves[i]);
+                            }
+                            std::cout << std::endl;
+                        } else
+                            std::cout << pvss.str() << std::endl;
                     }
-                    std::cout << " hashfull " << threadInfo.searcher.TT.hashfull();
-                    std::cout << " nodes " << nodecnt << " nps " << nodecnt / (limit.timer.elapsed() + 1) * 1000 << " time " << limit.timer.elapsed() << " pv ";
-                    std::cout << pvss.str() << std::endl;
                 }
                 else {
                     CURSOR::clearAll();
@@ -952,7 +1031,7 @@ namespace Search {
                 bmStability = 0;
             prevMove = threadInfo.bestMove;
 
-            if (limit.outOfTimeSoft(lastPV.moves[0], threadInfo.nodes, complexity, bmStability))
+            if (!stillPondering() && limit.outOfTimeSoft(threadInfo.rootMoves.nodes(lastPV.moves[0]), threadInfo.loadNodes(), complexity, bmStability))
                 break;
         }
 
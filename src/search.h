@@ -11,6 +11,7 @@
 #include <atomic>
 #include <condition_variable>
 #include <cstring>
+#include <memory>
 #include <mutex>
 #include <thread>
 
@@ -26,12 +27,46 @@ struct Searcher;
 namespace Search {
 
     void fillLmr();
+    size_t lmrTableBytes();
     bool isMateScore(int score);
     bool isWin(int score);
     bool isLoss(int score);
     int storeScore(int score, int ply);
     int readScore(int score, int ply);
-    int evaluate(Board& board, Stack* ss, InputBucketCache& bucketCache);
+
+    // Per thread cache of network evaluations, 256KB so it stays in L2
+    struct EvalCache {
+            struct Entry {
+                    uint32_t key;
+                    int32_t eval;
+            };
+            static constexpr size_t SIZE = 1 << 15;
+
+            std::array<Entry, SIZE> entries;
+            uint64_t probes = 0;
+            uint64_t hits = 0;
+
+            bool probe(uint64_t hash, int& eval) {
+                probes++;
+                Entry& entry = entries[hash & (SIZE - 1)];
+                if (entry.key != static_cast<uint32_t>(hash >> 32))
+                    return false;
+                hits++;
+                eval = entry.eval;
+                return true;
+            }
+            void prefetch(uint64_t hash) {
+                __builtin_prefetch(&entries[hash & (SIZE - 1)]);
+            }
+            void store(uint64_t hash, int eval) {
+                entries[hash & (SIZE - 1)] = {static_cast<uint32_t>(hash >> 32), eval};
+            }
+            void clear() {
+                entries.fill({0, 0});
+            }
+    };
+
+    int evaluate(Board& board, Stack* ss, InputBucketCache& bucketCache, EvalCache& evalCache);
 
     inline int historyBonus(int depth) {
         return std::min(HIST_BONUS_QUADRATIC() * depth * depth + HIST_BONUS_LINEAR() * depth + HIST_BONUS_OFFSET(),
@@ -58,23 +93,6 @@ namespace Search {
                          1024);
     }
 
-    inline uint64_t prefetchKey(Board& board, Move move) {
-        Piece movingPiece = board.at(move.from());
-        Piece captured = board.at(move.to());
-        uint64_t key = board.hash();
-
-        // Update Zobrist
-        key ^= Zobrist::piece(movingPiece, move.from());
-        key ^= Zobrist::piece(movingPiece, move.to());
-
-        if (captured != Piece::NONE)
-            key ^= Zobrist::piece(captured, move.to());
-
-        key ^= Zobrist::sideToMove();
-        return key;
-
-    }
-
     struct PVList {
             std::array<chess::Move, MAX_PLY> moves;
             uint32_t length;
@@ -93,34 +111,133 @@ namespace Search {
             }
     };
 
-    struct alignas(64) Stack {
+    struct RootMove {
+            Move move;
+            int score = -EVAL_INF;
+            int previousScore = -EVAL_INF;
+            // Nodes spent below this move over the whole search
+            uint64_t nodes = 0;
             PVList pv;
-            chess::Move killer;
-            int staticEval;
-            int eval;
-            int historyScore;
-            int ply;
-            int failHighs;
-            int reduction;
 
+            RootMove(Move m) : move(m) {}
+    };
+
+    // Legal root moves of one thread. After every iteration the searched lines are in front,
+    // best first, followed by the remaining moves by node count
+    struct RootMoves {
+            std::vector<RootMove> moves;
+            // MultiPV line being searched, moves[0..pvIndex) are excluded at the root
+            int pvIndex = 0;
+
+            // searchMoves restricts the root to those moves unless none of them are legal
+            void init(Board& board, const std::vector<Move>& searchMoves) {
+                Movelist legal;
+                movegen::legalmoves(legal, board);
+                moves.clear();
+                pvIndex = 0;
+                for (Move move : legal) {
+                    if (searchMoves.empty() || std::find(searchMoves.begin(), searchMoves.end(), move) != searchMoves.end())
+                        moves.emplace_back(move);
+                }
+                if (moves.empty()) {
+                    for (Move move : legal)
+                        moves.emplace_back(move);
+                }
+                restricted = moves.size() != static_cast<size_t>(legal.size());
+            }
+            size_t size() const {
+                return moves.size();
+            }
+            RootMove& operator[](size_t i) {
+                return moves[i];
+            }
+            RootMove* find(Move move) {
+                for (RootMove& rm : moves) {
+                    if (rm.move == move)
+                        return &rm;
+                }
+                return nullptr;
+            }
+            // Moves the root search must not play, either outside searchmoves or already
+            // taken by an earlier MultiPV line
+            bool skip(Move move) {
+                if (restricted && !find(move))
+                    return true;
+                for (int i = 0; i < pvIndex; i++) {
+                    if (moves[i].move == move)
+                        return true;
+                }
+                return false;
+            }
+            void addNodes(Move move, uint64_t nodes) {
+                if (RootMove* rm = find(move))
+                    rm->nodes += nodes;
+            }
+            uint64_t nodes(Move move) {
+                RootMove* rm = find(move);
+                return rm ? rm->nodes : 0;
+            }
+            // Set once an iteration has completed, from then on the root searches in this order
+            bool ordered() const {
+                return !moves.empty() && moves[0].previousScore != -EVAL_INF;
+            }
+            void startIteration() {
+                for (RootMove& rm : moves)
+                    rm.previousScore = rm.score;
+            }
+            // Stores the result of MultiPV line k and moves its root move into slot k
+            void pickLine(int k, Move move, int score, const PVList& pv) {
+                for (size_t i = k; i < moves.size(); i++) {
+                    if (moves[i].move != move)
+                        continue;
+                    moves[i].score = score;
+                    moves[i].pv = pv;
+                    std::rotate(moves.begin() + k, moves.begin() + i, moves.begin() + i + 1);
+                    return;
+                }
+            }
+            // Orders the moves after the first `lines` by the effort spent on them
+            void sortRest(int lines) {
+                if (static_cast<size_t>(lines) >= moves.size())
+                    return;
+                std::stable_sort(moves.begin() + lines, moves.end(), [](const RootMove& a, const RootMove& b) {
+                    return a.nodes > b.nodes;
+                });
+            }
+
+        private:
+            bool restricted = false;
+    };
+
+    // Ordered by alignment so the entry fits in two cache lines
+    struct alignas(64) Stack {
             uint64_t pawnKey;
             uint64_t majorKey;
             uint64_t minorKey;
             std::array<uint64_t, 2> nonPawnKey;
 
-            std::array<Bitboard, 7> threats;
+            MultiArray<int16_t, 2, 6, 64>* conthist;
+            MultiArray<int16_t, 2, 6, 64>* contCorrhist;
+            Accumulator* accumulator;
 
+            chess::Move killer;
             Move excluded{};
             Move bestMove{};
-
             Move move{};
+
+            int staticEval;
+            int eval;
+            int historyScore;
+            int ply;
+            int failHighs;
+            int reduction;
+
             Square toSquare = Square::NO_SQ;
+            // Whether ThreadInfo::threatTable and pinTable hold this node's threats and pins
+            bool threatsReady;
+            bool pinsReady;
             PieceType movedPiece;
-            MultiArray<int16_t, 2, 6, 64>* conthist;
-            MultiArray<int16_t, 2, 6, 64>* contCorrhist;
 
-            Accumulator* accumulator;
-            
             void reset() {
                 killer = Move::NO_MOVE;
                 staticEval = EVAL_NONE;
@@ -133,7 +250,8 @@ namespace Search {
                 majorKey = 0;
                 minorKey = 0;
                 nonPawnKey.fill(0);
-                threats.fill(Bitboard());
+                threatsReady = false;
+                pinsReady = false;
                 move = Move::NO_MOVE;
                 toSquare = Square::NO_SQ;
                 excluded = Move::NO_MOVE;
@@ -143,6 +261,7 @@ namespace Search {
                 movedPiece = PieceType::NONE;
             }
     };
+    static_assert(sizeof(Stack) == 128, "Stack should span two cache lines");
 
     struct Limit {
             TimeLimit timer;
@@ -156,8 +275,6 @@ namespace Search {
             bool enableClock;
             Color color;
 
-            std::array<uint64_t, 4096> nodeCounts;
-
             Limit() {
                 depth = 0;
                 ctime = 0;
@@ -184,9 +301,6 @@ namespace Search {
                 }
                 timer.start();
             }
-            void updateNodes(Move move, uint64_t nodes) {
-                nodeCounts[move.move() & 4095] += nodes;
-            }
             bool outOfNodes(int64_t cnt) {
                 return maxnodes != -1 && cnt > maxnodes;
             }
@@ -196,11 +310,11 @@ namespace Search {
             bool outOfTime() {
                 return (enableClock && static_cast<int64_t>(timer.elapsed()) >= movetime);
             }
-            bool outOfTimeSoft(Move bestMove, uint64_t totalNodes, double complexity, int bmStability) {
+            bool outOfTimeSoft(uint64_t bestMoveNodes, uint64_t totalNodes, double complexity, int bmStability) {
                 if (!enableClock || softtime == 0)
                     return false;
 
-                double prop = static_cast<double>(nodeCounts[bestMove.move() & 4095]) / static_cast<double>(totalNodes);
+                double prop = static_cast<double>(bestMoveNodes) / static_cast<double>(totalNodes);
                 double scale = (NODE_TM_BASE() / 100.0 - prop) * (NODE_TM_SCALE() / 100.0);
                 double compScale = std::max((COMPLEXITY_TM_BASE() / 100.0) + std::clamp(complexity, 0.0, 200.0) / static_cast<double>(COMPLEXITY_TM_DIVISOR()), 1.0);
                 double bmScale = std::max<double>(1.8 - 0.1 * static_cast<double>(bmStability), 0.9);
@@ -208,10 +322,64 @@ namespace Search {
             }
     };
 
+    // History values stay within +-MAX_HISTORY, so every table fits in int16
+    struct Histories {
+            // indexed by [stm][from][to][threat]
+            MultiArray<int16_t, 2, 64, 64, 4> history;
+            // indexed by [stm][hash % entries][pt][to]
+            MultiArray<int16_t, 2, PAWN_HIST_ENTRIES, 6, 64> pawnHistory;
+            // indexed by [prev stm][prev pt][prev to][stm][pt][to]
+            MultiArray<int16_t, 2, 6, 64, 2, 6, 64> conthist;
+            MultiArray<int16_t, 2, 6, 64, 2, 6, 64> contCorrhist;
+            // indexed by [stm][moving pt][cap pt][to][threat]
+            MultiArray<int16_t, 2, 6, 6, 64, 4> capthist;
+            // indexed by [stm][hash % entries]
+            MultiArray<int16_t, 2, CORR_HIST_ENTRIES> pawnCorrhist;
+            MultiArray<int16_t, 2, CORR_HIST_ENTRIES> majorCorrhist;
+            MultiArray<int16_t, 2, CORR_HIST_ENTRIES> minorCorrhist;
+            MultiArray<int16_t, 2, CORR_HIST_ENTRIES> whiteNonPawnCorrhist;
+            MultiArray<int16_t, 2, CORR_HIST_ENTRIES> blackNonPawnCorrhist;
+
+            void clear() {
+                history.fill(DEFAULT_HISTORY);
+                conthist.fill(DEFAULT_HISTORY);
+                pawnHistory.fill(DEFAULT_HISTORY);
+                contCorrhist.fill(DEFAULT_HISTORY);
+                capthist.fill(DEFAULT_HISTORY);
+                pawnCorrhist.fill(DEFAULT_HISTORY);
+                majorCorrhist.fill(DEFAULT_HISTORY);
+                minorCorrhist.fill(DEFAULT_HISTORY);
+                whiteNonPawnCorrhist.fill(DEFAULT_HISTORY);
+                blackNonPawnCorrhist.fill(DEFAULT_HISTORY);
+            }
+    };
+
+    // Bytes held by one search thread
+    struct ThreadFootprint {
+            size_t histories;
+            size_t accumulators;
+            size_t searchStack;
+            size_t bucketCache;
+            size_t evalCache;
+            size_t other;
+
+            size_t total() const {
+                return histories + accumulators + searchStack + bucketCache + evalCache + other;
+            }
+    };
+
+    // Other threads see a worker's node count at this granularity
+    constexpr uint64_t NODE_PUBLISH_INTERVAL = 1024;
+
     struct alignas(128) ThreadInfo {
+            // Exact count, only touched by the owning thread
+            uint64_t localNodes = 0;
+            // localNodes as last published for other threads
             std::atomic<uint64_t> nodes;
             std::atomic<bool> stopped;
             std::atomic<bool> exiting;
+            // Set while the thread is inside startSearching
+            std::atomic<bool> searching = false;
 
             std::thread thread;
             ThreadType type;
@@ -219,44 +387,66 @@ namespace Search {
             Board board;
             Limit limit;
             InputBucketCache bucketCache;
+            EvalCache evalCache;
+            // TT and killer moves checked with isLegal by the move picker
+            uint64_t moveValidations = 0;
+            // Nodes that may need threat maps and how many actually computed them
+            uint64_t threatNodes = 0;
+            uint64_t threatComputations = 0;
+            TTStats ttStats;
             std::vector<Accumulator> accStack;
             std::vector<Stack> searchStack;
             
+            RootMoves rootMoves;
+            // Triangular PV table, pvTable[ply] is the PV from ply. It lives outside Stack so
+            // the stack entries touched at every ply stay small
+            std::array<PVList, MAX_PLY + 1> pvTable;
+            // Threat maps and pinners and king blockers per searchStack entry, filled through
+            // threats() and pins(). Keyed by the entry, not the ply, as verification searches
+            // reuse an entry at ply + 1. They live outside Stack to keep it in two cache lines
+            std::array<std::array<Bitboard, 7>, MAX_PLY + STACK_OVERHEAD + 3> threatTable;
+            std::array<StateInfo, MAX_PLY + STACK_OVERHEAD + 3> pinTable;
+
             Move bestMove;
+            Move ponderMove;
             int bestRootScore;
             int minNmpPly;
             int rootDepth;
             int selDepth;
-            int completed;
+            // Read by the timer and for voting while the thread searches
+            std::atomic<int> completed;
 
             Searcher& searcher;
             int threadId;
 
-            // indexed by [stm][from][to][threat]
-            MultiArray<int, 2, 64, 64, 4> history;
-            // indexed by [stm][hash % entries][pt][to]
-            MultiArray<int16_t, 2, PAWN_HIST_ENTRIES, 6, 64> pawnHistory;
-            // indexed by [prev stm][prev pt][prev to][stm][pt][to]
-            MultiArray<int16_t, 2, 6, 64, 2, 6, 64> conthist;
-            MultiArray<int16_t, 2, 6, 64, 2, 6, 64> contCorrhist;
-            // indexed by [stm][moving pt][cap pt][to][threat]
-            MultiArray<int, 2, 6, 6, 64, 4> capthist;
-            // indexed by [stm][hash % entries]
-            MultiArray<int16_t, 2, CORR_HIST_ENTRIES> pawnCorrhist;
-            MultiArray<int16_t, 2, CORR_HIST_ENTRIES> majorCorrhist;
-            MultiArray<int16_t, 2, CORR_HIST_ENTRIES> minorCorrhist;
-            MultiArray<int16_t, 2, CORR_HIST_ENTRIES> whiteNonPawnCorrhist;
-            MultiArray<int16_t, 2, CORR_HIST_ENTRIES> blackNonPawnCorrhist;
+            // Allocated and cleared by the thread itself on ucinewgame or isready, see
+            // Searcher::prepareThreads, so the pages are local to its node and all threads
+            // clear in parallel. A search started without either prepares them first
+            std::unique_ptr<Histories> histories;
+            bool historiesDirty = true;
 
             ThreadInfo(ThreadType t, Searcher& s);
             ThreadInfo(int id, Searcher& s);
             ~ThreadInfo();
+            static std::unique_ptr<ThreadInfo> spawn(int id, Searcher& s);
             void exit();
             void startSearching();
             void waitForSearchFinished();
             void idle();
 
+            // Owning thread only
             size_t loadNodes() {
+                return localNodes;
+            }
+            void addNode() {
+                if ((++localNodes & (NODE_PUBLISH_INTERVAL - 1)) == 0)
+                    nodes.store(localNodes, std::memory_order::relaxed);
+            }
+            void publishNodes() {
+                nodes.store(localNodes, std::memory_order::relaxed);
+            }
+            // Safe from any thread
+            size_t publishedNodes() {
                 return nodes.load(std::memory_order::relaxed);
             }
 
@@ -265,7 +455,58 @@ namespace Search {
             }
             void prepare() {
                 stopped = false;
+                searching = true;
+                completed = 0;
+                localNodes = 0;
                 nodes = 0;
+                ttStats = TTStats();
+                evalCache.probes = evalCache.hits = 0;
+                moveValidations = 0;
+                threatNodes = threatComputations = 0;
+            }
+
+            // Called by the owning thread between searches and before it searches
+            void prepareHistories() {
+                if (!histories) {
+                    histories = std::make_unique<Histories>();
+                    historiesDirty = true;
+                }
+                if (historiesDirty)
+                    histories->clear();
+                historiesDirty = false;
+            }
+            ThreadFootprint footprint() const {
+                ThreadFootprint f;
+                f.histories = histories ? sizeof(Histories) : 0;
+                f.accumulators = accStack.capacity() * sizeof(Accumulator);
+                f.searchStack = searchStack.capacity() * sizeof(Stack);
+                f.bucketCache = sizeof(InputBucketCache);
+                f.evalCache = sizeof(EvalCache);
+                f.other = sizeof(ThreadInfo) - f.bucketCache - f.evalCache + rootMoves.moves.capacity() * sizeof(RootMove);
+                return f;
+            }
+
+            // Threat maps of the node at ss, nodes that cut off before ordering or
+            // scoring any move never compute them
+            const std::array<Bitboard, 7>& threats(Stack* ss) {
+                std::array<Bitboard, 7>& threats = threatTable[ss - searchStack.data()];
+                if (!ss->threatsReady) {
+                    threats = calculateThreats(board);
+                    ss->threatsReady = true;
+                    threatComputations++;
+                }
+                return threats;
+            }
+
+            // Pins of the node at ss for SEE and pseudo legal move generation, computed on
+            // first use like the threat maps
+            const StateInfo& pins(Stack* ss) {
+                StateInfo& state = pinTable[ss - searchStack.data()];
+                if (!ss->pinsReady) {
+                    state = calculatePins(board);
+                    ss->pinsReady = true;
+                }
+                return state;
             }
 
             int threatIndex(Move move, Bitboard threats){
@@ -280,7 +521,7 @@ namespace Search {
             // Butterfly history
             void updateHistory(Stack* ss, Board& board, Move m, int bonus) {
                 int clamped = std::clamp<int>(bonus, -MAX_HISTORY_BONUS, MAX_HISTORY_BONUS);
-                int& entry = history[(int)board.sideToMove()][m.from().index()][m.to().index()][threatIndex(m, ss->threats[6])];
+                int16_t& entry = histories->history[(int)board.sideToMove()][m.from().index()][m.to().index()][threatIndex(m, threats(ss)[6])];
                 entry += clamped - entry * std::abs(clamped) / MAX_HISTORY;
             }
 
@@ -288,8 +529,8 @@ namespace Search {
             void updateCapthist(Stack* ss, Board& board, Move m, int depth, bool b) {
                 int bonus = b ? historyBonusCapt(depth) : historyMalus(depth);
                 int clamped = std::clamp<int>(bonus, -MAX_HISTORY_BONUS, MAX_HISTORY_BONUS);
-                int& entry = capthist[board.sideToMove()][board.at<PieceType>(m.from())][board.at<PieceType>(m.to())]
-                                     [m.to().index()][threatIndex(m, ss->threats[6])];
+                int16_t& entry = histories->capthist[board.sideToMove()][board.at<PieceType>(m.from())][board.at<PieceType>(m.to())]
+                                     [m.to().index()][threatIndex(m, threats(ss)[6])];
                 entry += clamped - entry * std::abs(clamped) / MAX_HISTORY;
             }
 
@@ -315,7 +556,7 @@ namespace Search {
             void updatePawnhist(Stack* ss, Board& board, Move m, int16_t bonus) {
                 int16_t clamped = std::clamp<int16_t>(bonus, -MAX_HISTORY_BONUS, MAX_HISTORY_BONUS);
                 int16_t& entry = 
-                    pawnHistory[board.sideToMove()][ss->pawnKey % PAWN_HIST_ENTRIES][(int)board.at<PieceType>(m.from())][m.to().index()];
+                    histories->pawnHistory[board.sideToMove()][ss->pawnKey % PAWN_HIST_ENTRIES][(int)board.at<PieceType>(m.from())][m.to().index()];
                 entry += clamped - entry * std::abs(clamped) / MAX_HISTORY;
                 entry = std::clamp(int(entry), int(-MAX_HISTORY), int(MAX_HISTORY));
             }
@@ -339,11 +580,11 @@ namespace Search {
                     int16_t clamped = std::clamp(bonus, -MAX_CORR_HIST / 4, MAX_CORR_HIST / 4);
                     entry += clamped - entry * std::abs(clamped) / MAX_CORR_HIST;
                 };
-                updateEntry(pawnCorrhist[board.sideToMove()][ss->pawnKey % CORR_HIST_ENTRIES]);
-                updateEntry(majorCorrhist[board.sideToMove()][ss->majorKey % CORR_HIST_ENTRIES]);
-                updateEntry(minorCorrhist[board.sideToMove()][ss->minorKey % CORR_HIST_ENTRIES]);
-                updateEntry(whiteNonPawnCorrhist[board.sideToMove()][ss->nonPawnKey[0] % CORR_HIST_ENTRIES]);
-                updateEntry(blackNonPawnCorrhist[board.sideToMove()][ss->nonPawnKey[1] % CORR_HIST_ENTRIES]);
+                updateEntry(histories->pawnCorrhist[board.sideToMove()][ss->pawnKey % CORR_HIST_ENTRIES]);
+                updateEntry(histories->majorCorrhist[board.sideToMove()][ss->majorKey % CORR_HIST_ENTRIES]);
+                updateEntry(histories->minorCorrhist[board.sideToMove()][ss->minorKey % CORR_HIST_ENTRIES]);
+                updateEntry(histories->whiteNonPawnCorrhist[board.sideToMove()][ss->nonPawnKey[0] % CORR_HIST_ENTRIES]);
+                updateEntry(histories->blackNonPawnCorrhist[board.sideToMove()][ss->nonPawnKey[1] % CORR_HIST_ENTRIES]);
                 // Continuation Correction History
                 if (ss->ply >= 2 && (ss - 2)->contCorrhist != nullptr && !moveIsNull((ss - 2)->move) && !moveIsNull((ss - 1)->move)) {
                     auto &table = *(ss - 2)->contCorrhist;
@@ -354,19 +595,19 @@ namespace Search {
             }
             // ----------------- History getters
             int getHistory(Color c, Move m, Stack* ss) {
-                return history[(int)c][m.from().index()][m.to().index()][threatIndex(m, ss->threats[6])];
+                return histories->history[(int)c][m.from().index()][m.to().index()][threatIndex(m, threats(ss)[6])];
             }
 
             int getCapthist(Board& board, Move m, Stack* ss) {
-                return capthist[board.sideToMove()][board.at<PieceType>(m.from())][board.at<PieceType>(m.to())]
-                               [m.to().index()][threatIndex(m, ss->threats[6])];
+                return histories->capthist[board.sideToMove()][board.at<PieceType>(m.from())][board.at<PieceType>(m.to())]
+                               [m.to().index()][threatIndex(m, threats(ss)[6])];
             }
 
             MultiArray<int16_t, 2, 6, 64>* getConthistSegment(Board& board, Move m) {
-                return &conthist[board.sideToMove()][(int)board.at<PieceType>(m.from())][m.to().index()];
+                return &histories->conthist[board.sideToMove()][(int)board.at<PieceType>(m.from())][m.to().index()];
             }
             MultiArray<int16_t, 2, 6, 64>* getContCorrhistSegment(Board& board, Move m) {
-                return &contCorrhist[board.sideToMove()][(int)board.at<PieceType>(m.from())][m.to().index()];
+                return &histories->contCorrhist[board.sideToMove()][(int)board.at<PieceType>(m.from())][m.to().index()];
             }
 
             int16_t getConthist(MultiArray<int16_t, 2, 6, 64>* c, Board& board, Move m) {
@@ -375,7 +616,7 @@ namespace Search {
             }
 
             int16_t getPawnhist(Board& board, Move m, Stack* ss) {
-                return pawnHistory[board.sideToMove()][ss->pawnKey % PAWN_HIST_ENTRIES][(int)board.at<PieceType>(m.from())][m.to().index()];
+                return histories->pawnHistory[board.sideToMove()][ss->pawnKey % PAWN_HIST_ENTRIES][(int)board.at<PieceType>(m.from())][m.to().index()];
             }
 
             int getQuietHistory(Board& board, Move m, Stack* ss) {
@@ -392,13 +633,13 @@ namespace Search {
 
             int correctStaticEval(Stack* ss, Board& board, int eval) {
                 int correction = 0;
-                correction += PAWN_CORR_WEIGHT() * pawnCorrhist[board.sideToMove()][ss->pawnKey % CORR_HIST_ENTRIES];
-                correction += MAJOR_CORR_WEIGHT() * majorCorrhist[board.sideToMove()][ss->majorKey % CORR_HIST_ENTRIES];
-                correction += MINOR_CORR_WEIGHT() * minorCorrhist[board.sideToMove()][ss->minorKey % CORR_HIST_ENTRIES];
+                correction += PAWN_CORR_WEIGHT() * histories->pawnCorrhist[board.sideToMove()][ss->pawnKey % CORR_HIST_ENTRIES];
+                correction += MAJOR_CORR_WEIGHT() * histories->majorCorrhist[board.sideToMove()][ss->majorKey % CORR_HIST_ENTRIES];
+                correction += MINOR_CORR_WEIGHT() * histories->minorCorrhist[board.sideToMove()][ss->minorKey % CORR_HIST_ENTRIES];
                 correction += NON_PAWN_STM_CORR_WEIGHT() *
-                              whiteNonPawnCorrhist[board.sideToMove()][ss->nonPawnKey[0] % CORR_HIST_ENTRIES];
+                              histories->whiteNonPawnCorrhist[board.sideToMove()][ss->nonPawnKey[0] % CORR_HIST_ENTRIES];
                 correction += NON_PAWN_NSTM_CORR_WEIGHT() *
-                              blackNonPawnCorrhist[board.sideToMove()][ss->nonPawnKey[1] % CORR_HIST_ENTRIES];
+                              histories->blackNonPawnCorrhist[board.sideToMove()][ss->nonPawnKey[1] % CORR_HIST_ENTRIES];
 
                 // Continuation Correction History
                 if (ss->ply >= 2 && (ss - 2)->contCorrhist != nullptr && !moveIsNull((ss - 2)->move) && !moveIsNull((ss - 1)->move)) {
@@ -411,18 +652,11 @@ namespace Search {
                 return std::clamp(corrected, GETTING_MATED + 1, FOUND_MATE - 1);
             }
             void reset() {
+                localNodes = 0;
                 nodes = 0;
                 bestMove = Move::NO_MOVE;
-                history.fill((int)DEFAULT_HISTORY);
-                conthist.fill(DEFAULT_HISTORY);
-                pawnHistory.fill(DEFAULT_HISTORY);
-                contCorrhist.fill(DEFAULT_HISTORY);
-                capthist.fill((int)DEFAULT_HISTORY);
-                pawnCorrhist.fill(DEFAULT_HISTORY);
-                majorCorrhist.fill(DEFAULT_HISTORY);
-                minorCorrhist.fill(DEFAULT_HISTORY);
-                whiteNonPawnCorrhist.fill(DEFAULT_HISTORY);
-                blackNonPawnCorrhist.fill(DEFAULT_HISTORY);
+                evalCache.clear();
+                historiesDirty = true;
                 bestRootScore = -EVAL_INF;
                 rootDepth = 0;
                 completed = 0;
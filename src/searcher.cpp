@@ -4,6 +4,7 @@
 #include "util.h"
 #include <atomic>
 #include <condition_variable>
+#include <latch>
 #include <mutex>
 #include <thread>
 #include <vector>
@@ -13,8 +14,6 @@ Search::ThreadInfo::ThreadInfo(ThreadType t, Searcher& s)
     board = Board();
     stopped = false;
     exiting = false;
-    thread = std::thread(&Search::ThreadInfo::idle, this);
-    reset();
 };
 
 Search::ThreadInfo::ThreadInfo(int id, Searcher& s)
@@ -23,44 +22,87 @@ Search::ThreadInfo::ThreadInfo(int id, Searcher& s)
     board = Board();
     stopped = false;
     exiting = false;
-    thread = std::thread(&Search::ThreadInfo::idle, this);
-    reset();
 };
 
+// Starts a worker and waits for its first reset. The worker pins itself before it
+// constructs its ThreadInfo, so the caches, tables and stacks are first touched on its node
+std::unique_ptr<Search::ThreadInfo> Search::ThreadInfo::spawn(int id, Searcher& s) {
+    ThreadInfo* info = nullptr;
+    std::latch ready(1);
+    std::thread worker([id, &s, &info, &ready]() {
+        NUMA::bindThread(NUMA::bindingCpus(s.threadBinding, s.bindingOffset + id));
+        ThreadInfo* self = new ThreadInfo(id, s);
+        self->reset();
+        info = self;
+        ready.count_down();
+        self->idle();
+    });
+    ready.wait();
+    info->thread = std::move(worker);
+    return std::unique_ptr<ThreadInfo>(info);
+}
+
 void Search::ThreadInfo::exit() {
     exiting = true;
 }
 
 Search::ThreadInfo::~ThreadInfo() {
-    thread.join();
+    if (thread.joinable())
+        thread.join();
 }
 
 void Search::ThreadInfo::startSearching() {
+    localNodes = 0;
     nodes = 0;
     bestMove = Move::NO_MOVE;
+    ponderMove = Move::NO_MOVE;
     bestRootScore = -EVAL_INF;
     board = searcher.board;
+    prepareHistories();
+    rootMoves.init(board, searcher.searchMoves);
     searchStack[STACK_OVERHEAD].accumulator->refresh(board);
     bucketCache = InputBucketCache();
     
     Search::iterativeDeepening(*this, searcher.limit);
+    publishNodes();
 
     if (type == ThreadType::MAIN) {
+        // bestmove must wait for ponderhit or stop
+        searcher.pondering.wait(true);
         searcher.stopSearching();
-        // Possible thread voting for future
-        ThreadInfo* bestSearcher = this;
+        searcher.waitForWorkersFinished();
+
+        // MultiPV lines come from the main thread only
+        ThreadInfo* bestSearcher = searcher.threads.size() > 1 && searcher.multiPV == 1 ? searcher.voteBestThread() : this;
         searcher.bestScore = bestSearcher->bestRootScore;
-        
-        if (searcher.printInfo)
-            std::cout << "\nbestmove "
-                      << uci::moveToUci(bestSearcher->bestMove,
-                                        searcher.board.chess960())
-                      << std::endl;
+
+        if (searcher.printInfo && searcher.threads.size() > 1) {
+            std::cout << "info string thread depths";
+            for (auto& thread : searcher.threads)
+                std::cout << " " << thread.get()->completed;
+            std::cout << std::endl;
+            if (bestSearcher != this)
+                std::cout << "info string voted move " << uci::moveToUci(bestSearcher->bestMove, searcher.board.chess960())
+                          << " from thread " << bestSearcher->threadId << " depth " << bestSearcher->completed
+                          << std::endl;
+        }
+
+        searcher.disarmTimer();
+        if (searcher.printInfo) {
+            std::cout << "\nbestmove " << uci::moveToUci(bestSearcher->bestMove, searcher.board.chess960());
+            if (searcher.ponder && !moveIsNull(bestSearcher->ponderMove))
+                std::cout << " ponder " << uci::moveToUci(bestSearcher->ponderMove, searcher.board.chess960());
+            std::cout << std::endl;
+        }
+        if (searcher.printInfo && searcher.showStats)
+            searcher.printStats();
     }
+    searching = false;
+    searching.notify_all();
 }
 
 void Search::ThreadInfo::waitForSearchFinished() {
-    
+    searching.wait(true);
 }
 
 void Search::ThreadInfo::idle() {
@@ -68,10 +110,20 @@ void Search::ThreadInfo::idle() {
         searcher.idleBarrier->arrive_and_wait();
         if (exiting)
             return;
+        if (searcher.resizing) {
+            uint64_t generation = searcher.poolGeneration;
+            searcher.parked--;
+            searcher.parked.notify_all();
+            searcher.poolGeneration.wait(generation);
+            continue;
+        }
         {
             std::shared_lock lockGuard{searcher.mutex};
             (void)searcher.startedBarrier->arrive();
-            startSearching();
+            if (searcher.preparing)
+                prepareHistories();
+            else
+                startSearching();
         }
     }
 }
\ No newline at end of file
@@ -5,18 +5,30 @@
 #include "tt.h"
 #include <atomic>
 #include <barrier>
+#include <chrono>
 #include <condition_variable>
+#include <mutex>
+#include <optional>
 #include <shared_mutex>
 #include <thread>
 #include <vector>
 
 struct Searcher {
-        TTable TT;
+        // Searchers built on a shared TT (batch analysis) leave clearing and aging it to its owner
+        std::unique_ptr<TTable> ownTT;
+        TTable& TT;
         std::vector<std::unique_ptr<Search::ThreadInfo>> threads;
         using BarrierPtr = std::unique_ptr<std::barrier<>>;
         std::shared_mutex mutex;
         BarrierPtr idleBarrier;
         BarrierPtr startedBarrier;
+        // Set while initialize swaps the barriers, parked counts the threads still inside the old one.
+        // Parked threads wait for poolGeneration to change, a flag could be set again before they wake
+        std::atomic<bool> resizing = false;
+        std::atomic<size_t> parked = 0;
+        std::atomic<uint64_t> poolGeneration = 0;
+        // Set while prepareThreads has the released workers prepare their histories instead of searching
+        std::atomic<bool> preparing = false;
 
         Search::Limit limit;
         Board board;
@@ -24,46 +36,165 @@ struct Searcher {
         int bestScore = 0;
 
         bool showWDL;
+        bool showStats = false;
+        bool asyncClear = false;
+        // ThreadBinding option, see NUMA::bindingCpus
+        std::string threadBinding = "none";
+        // Added to thread ids when binding, so one thread searchers can sit on different CPUs
+        int bindingOffset = 0;
+        // Store eval-only NO_BOUND entries in the TT when the probe misses
+        bool ttEvalStores = true;
         bool printInfo = true;
         bool useSoft = false;
         bool normalizeEval = true;
+        int multiPV = 1;
+        // Root moves of go searchmoves, empty for all legal moves
+        std::vector<Move> searchMoves;
+        // Ponder option, only controls whether bestmove carries a ponder move
+        bool ponder = false;
+        // Set by go ponder until ponderhit or stop
+        std::atomic<bool> pondering = false;
 
-        Searcher() {
+        // Hard time limits are delivered by a timer thread, so search only reads stopped
+        std::thread timerThread;
+        std::mutex timerMutex;
+        std::condition_variable timerCv;
+        std::optional<std::chrono::steady_clock::time_point> deadline;
+        std::chrono::steady_clock::time_point timerFiredAt;
+        bool timerFired = false;
+        bool timerExiting = false;
+        // Set by the main thread once depth 1 is done, the timer never fires before that
+        bool firstDepthDone = false;
+        // Microseconds from the timer firing to bestmove in the last search, -1 if it did not fire
+        int64_t stopLatency = -1;
+
+        Searcher() : ownTT(std::make_unique<TTable>()), TT(*ownTT) {
             idleBarrier = std::make_unique<std::barrier<>>(1);
             startedBarrier = std::make_unique<std::barrier<>>(1);
+            timerThread = std::thread(&Searcher::timerLoop, this);
         }
-        void initialize(int num) {
-            if (threads.size() == num)
-                return;
+        explicit Searcher(TTable& sharedTT) : TT(sharedTT) {
+            idleBarrier = std::make_unique<std::barrier<>>(1);
+            startedBarrier = std::make_unique<std::barrier<>>(1);
+            timerThread = std::thread(&Searcher::timerLoop, this);
+        }
+        ~Searcher() {
             {
-                std::unique_lock lockGuard{mutex};
-                for (auto& thread : threads) {
-                    thread->exit();
+                std::lock_guard lock{timerMutex};
+                timerExiting = true;
+            }
+            timerCv.notify_all();
+            timerThread.join();
+        }
+
+        void timerLoop() {
+            std::unique_lock lock{timerMutex};
+            while (true) {
+                timerCv.wait(lock, [this] { return timerExiting || deadline.has_value(); });
+                if (timerExiting)
+                    return;
+                auto armed = *deadline;
+                if (timerCv.wait_until(lock, armed, [this, armed] { return timerExiting || deadline != armed; }))
+                    continue;
+                // Depth 1 always completes so there is a move to play, the main thread wakes us
+                if (!firstDepthDone) {
+                    timerCv.wait(lock, [this, armed] { return timerExiting || firstDepthDone || deadline != armed; });
+                    continue;
                 }
-                idleBarrier->arrive_and_wait();
-                threads.clear();
+                deadline.reset();
+                timerFired = true;
+                timerFiredAt = std::chrono::steady_clock::now();
+                stopSearching();
+            }
+        }
+        void armTimer() {
+            {
+                std::lock_guard lock{timerMutex};
+                timerFired = false;
+                firstDepthDone = false;
+                if (limit.enableClock && !pondering)
+                    deadline = limit.timer.deadline(limit.movetime);
+                else
+                    deadline.reset();
+            }
+            timerCv.notify_all();
+        }
+        // Called by the main thread when it completes depth 1
+        void firstDepthCompleted() {
+            {
+                std::lock_guard lock{timerMutex};
+                firstDepthDone = true;
+            }
+            timerCv.notify_all();
+        }
+        // The opponent played the expected move, the clock starts now
+        void ponderhit() {
+            if (!pondering)
+                return;
+            limit.timer.start();
+            {
+                std::lock_guard lock{timerMutex};
+                timerFired = false;
+                if (limit.enableClock)
+                    deadline = limit.timer.deadline(limit.movetime);
+            }
+            timerCv.notify_all();
+            pondering = false;
+            pondering.notify_all();
+        }
+        // Called by the main thread before bestmove
+        void disarmTimer() {
+            {
+                std::lock_guard lock{timerMutex};
+                deadline.reset();
+                stopLatency = timerFired ? std::chrono::duration_cast<std::chrono::microseconds>(
+                                               std::chrono::steady_clock::now() - timerFiredAt)
+                                               .count()
+                                         : -1;
             }
+            timerCv.notify_all();
+        }
+        // Grows or shrinks the pool, the threads that are kept keep their histories and
+        // accumulators. rebuild replaces every thread, e.g. to apply a new ThreadBinding
+        void initialize(int num, bool rebuild = false) {
+            if (threads.size() == num && !rebuild)
+                return;
+            std::unique_lock lockGuard{mutex};
+            size_t keep = rebuild ? 0 : std::min<size_t>(threads.size(), num);
+            for (size_t i = keep; i < threads.size(); i++)
+                threads[i]->exit();
+
+            // Release the idle threads once, the kept ones park until the new barriers exist
+            resizing = true;
+            parked = keep;
+            idleBarrier->arrive_and_wait();
+            threads.resize(keep);
+            for (size_t left = parked; left != 0; left = parked)
+                parked.wait(left);
+
             idleBarrier = std::make_unique<std::barrier<>>(1 + num);
             startedBarrier = std::make_unique<std::barrier<>>(1 + num);
+            for (size_t i = keep; i < num; i++)
+                threads.push_back(Search::ThreadInfo::spawn(i, *this));
 
-            if (num > 0) {
-                threads.push_back(std::make_unique<Search::ThreadInfo>(0, *this));
-                for (size_t i = 1; i < num; i++) {
-                    threads.push_back(std::make_unique<Search::ThreadInfo>(i, *this));
-                }
-            }
+            resizing = false;
+            poolGeneration++;
+            poolGeneration.notify_all();
         }
 
-        void startSearching(Board board, Search::Limit limit) {
+        void startSearching(Board board, Search::Limit limit, std::vector<Move> searchMoves = {}) {
             
             {
                 std::unique_lock lockGuard{mutex};
                 this->board = board;
                 this->limit = limit;
-                TT.incAge();
+                this->searchMoves = std::move(searchMoves);
+                if (ownTT)
+                    TT.incAge();
                 for (auto& thread : threads) {
                     thread->prepare();
                 }
+                armTimer();
             }
             idleBarrier->arrive_and_wait();
             startedBarrier->arrive_and_wait();
@@ -76,6 +207,8 @@ struct Searcher {
             for (auto& thread : threads) {
                 thread.get()->setStopped();
             }
+            pondering = false;
+            pondering.notify_all();
         }
         void waitForSearchFinished() {
             std::unique_lock lock{mutex};
@@ -85,21 +218,189 @@ struct Searcher {
                 threads[i].get()->waitForSearchFinished();
             }
         }
+        // Lazy SMP thread voting, each thread votes for its best move weighted by its
+        // completed depth and how far its score is above the worst one. Proven wins
+        // prefer the shortest mate
+        Search::ThreadInfo* voteBestThread() {
+            Search::ThreadInfo* best = threads[0].get();
+            int minScore = EVAL_INF;
+            for (auto& thread : threads) {
+                if (thread.get()->completed > 0 && !moveIsNull(thread.get()->bestMove))
+                    minScore = std::min(minScore, thread.get()->bestRootScore);
+            }
+
+            // Keyed by the full move, promotions to different pieces share from and to squares
+            std::vector<std::pair<Move, int64_t>> votes;
+            votes.reserve(threads.size());
+            auto vote = [&](Search::ThreadInfo* t) -> int64_t& {
+                for (auto& [move, weight] : votes) {
+                    if (move == t->bestMove)
+                        return weight;
+                }
+                return votes.emplace_back(t->bestMove, 0).second;
+            };
+            for (auto& thread : threads) {
+                Search::ThreadInfo* t = thread.get();
+                if (t->completed > 0 && !moveIsNull(t->bestMove))
+                    vote(t) += static_cast<int64_t>(t->bestRootScore - minScore + 14) * t->completed;
+            }
+
+            for (auto& thread : threads) {
+                Search::ThreadInfo* t = thread.get();
+                if (t == best || t->completed == 0 || moveIsNull(t->bestMove))
+                    continue;
+                if (Search::isWin(best->bestRootScore)) {
+                    if (t->bestRootScore > best->bestRootScore)
+                        best = t;
+                } else if (Search::isWin(t->bestRootScore)) {
+                    best = t;
+                } else if (!Search::isLoss(t->bestRootScore) &&
+                           (vote(t) > vote(best) || (vote(t) == vote(best) && t->completed > best->completed))) {
+                    best = t;
+                }
+            }
+            return best;
+        }
+
         void resizeTT(uint64_t size) {
-            TT.resize(size);
-            TT.clear(threads.size());
+            std::unique_lock lockGuard{mutex};
+            if (ownTT)
+                TT.resize(size, threads.size());
         }
         void reset() {
+            {
+                std::unique_lock lockGuard{mutex};
+                for (auto& thread : threads)
+                    thread.get()->reset();
+                if (ownTT)
+                    TT.clear(threads.size());
+            }
+            prepareThreads();
+        }
+        // ucinewgame, with AsyncClear the TT is cleared in the background and
+        // searches treat the clusters not cleared yet as empty
+        void newGame() {
+            if (!asyncClear) {
+                reset();
+                return;
+            }
+            {
+                std::unique_lock lockGuard{mutex};
+                for (auto& thread : threads)
+                    thread.get()->reset();
+                if (ownTT)
+                    TT.clearAsync(threads.size());
+            }
+            prepareThreads();
+        }
+        // Releases the idle workers to allocate and clear their histories on their own node,
+        // all in parallel, so the next go does not pay for it. Only call between searches
+        void prepareThreads() {
+            preparing = true;
+            idleBarrier->arrive_and_wait();
+            startedBarrier->arrive_and_wait();
+            waitForSearchFinished();
+            preparing = false;
+        }
+        bool isSearching() {
+            for (auto& thread : threads) {
+                if (thread.get()->searching)
+                    return true;
+            }
+            return false;
+        }
+
+        // Cached evals include the material scaling tunables, so they go stale when one is set
+        void clearEvalCaches() {
             std::unique_lock lockGuard{mutex};
             for (auto& thread : threads)
-                thread.get()->reset();
-            TT.clear(threads.size());
+                thread.get()->evalCache.clear();
+        }
+
+        uint64_t moveValidations() {
+            uint64_t count = 0;
+            for (auto& thread : threads)
+                count += thread.get()->moveValidations;
+            return count;
+        }
+
+        // Nodes that reached move ordering and how many of them computed threat maps
+        std::pair<uint64_t, uint64_t> threatStats() {
+            uint64_t nodes = 0, computed = 0;
+            for (auto& thread : threads) {
+                nodes += thread.get()->threatNodes;
+                computed += thread.get()->threatComputations;
+            }
+            return {nodes, computed};
+        }
+
+        TTStats ttStats() {
+            TTStats stats;
+            for (auto& thread : threads) {
+                stats.merge(thread.get()->ttStats);
+            }
+            return stats;
+        }
+
+        std::pair<uint64_t, uint64_t> evalCacheStats() {
+            uint64_t probes = 0, hits = 0;
+            for (auto& thread : threads) {
+                probes += thread.get()->evalCache.probes;
+                hits += thread.get()->evalCache.hits;
+            }
+            return {probes, hits};
+        }
+
+        // Counters of the last search as info strings, shown by the stats command
+        // and after bestmove with ShowStats
+        void printStats() {
+            TTStats stats = ttStats();
+            auto percent = [](uint64_t part, uint64_t total) {
+                return std::to_string(total == 0 ? 0 : 100 * part / total) + "%";
+            };
+            std::cout << "info string nodes " << nodeCount() << " hashfull " << TT.hashfull() << std::endl;
+            if (stopLatency >= 0)
+                std::cout << "info string stop latency " << stopLatency << "us" << std::endl;
+            std::cout << "info string tt probes " << stats.probes << " hits " << stats.hits << " ("
+                      << percent(stats.hits, stats.probes) << ")" << std::endl;
+            std::cout << "info string tt hits by depth";
+            for (int i = 0; i < TT_DEPTH_BUCKETS; i++) {
+                std::cout << " " << i * TT_DEPTH_BUCKET_WIDTH;
+                if (i == TT_DEPTH_BUCKETS - 1)
+                    std::cout << "+";
+                else
+                    std::cout << "-" << (i + 1) * TT_DEPTH_BUCKET_WIDTH - 1;
+                std::cout << " " << stats.hitsByDepth[i];
+            }
+            std::cout << std::endl;
+            std::cout << "info string tt stores " << stats.stores << " replacements " << stats.replacements
+                      << " ageevictions " << stats.ageEvictions << " skipped " << stats.skippedStores << " ("
+                      << percent(stats.skippedStores, stats.stores + stats.skippedStores) << ")" << std::endl;
+#ifdef PREFETCH_VERIFY
+            std::cout << "info string prefetch mismatches " << stats.prefetchMismatches << std::endl;
+#endif
+            auto [evalProbes, evalHits] = evalCacheStats();
+            std::cout << "info string eval cache probes " << evalProbes << " hits " << evalHits << " ("
+                      << percent(evalHits, evalProbes) << ")" << std::endl;
+            printThreadFootprint();
+        }
+        // Bytes held by the main thread and by all threads together
+        void printThreadFootprint() {
+            if (threads.empty())
+                return;
+            Search::ThreadFootprint f = threads[0]->footprint();
+            size_t total = 0;
+            for (auto& thread : threads)
+                total += thread->footprint().total();
+            std::cout << "info string thread memory histories " << f.histories << " accumulators " << f.accumulators
+                      << " stack " << f.searchStack << " bucketcache " << f.bucketCache << " evalcache " << f.evalCache
+                      << " other " << f.other << " total " << f.total() << " all threads " << total << std::endl;
         }
 
         uint64_t nodeCount() {
             uint64_t nodes = 0;
             for (auto& thread : threads) {
-                nodes += thread.get()->loadNodes();
+                nodes += thread.get()->publishedNodes();
             }
             return nodes;
         }
@@ -107,6 +408,25 @@ struct Searcher {
         void toggleWDL(bool x) {
             showWDL = x;
         }
+        void toggleStats(bool x) {
+            showStats = x;
+        }
+        void setThreadBinding(const std::string& mode) {
+            threadBinding = mode;
+            initialize(threads.size(), true);
+        }
+        void setMultiPV(int x) {
+            multiPV = std::max(x, 1);
+        }
+        void togglePonder(bool x) {
+            ponder = x;
+        }
+        void toggleAsyncClear(bool x) {
+            asyncClear = x;
+        }
+        void toggleTTEvalStores(bool x) {
+            ttEvalStores = x;
+        }
         void toggleSoft(bool x) {
             useSoft = x;
         }
@@ -3,17 +3,20 @@
 #include <chrono>
 
 class TimeLimit {
-        std::chrono::high_resolution_clock::time_point startTime;
+        std::chrono::steady_clock::time_point startTime;
 
     public:
         TimeLimit() {};
 
         void start() {
-            startTime = std::chrono::high_resolution_clock::now();
+            startTime = std::chrono::steady_clock::now();
         }
         int elapsed() {
-            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() -
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
                                                                          startTime)
                 .count();
         }
+        std::chrono::steady_clock::time_point deadline(int64_t ms) {
+            return startTime + std::chrono::milliseconds(ms);
+        }
 };
\ No newline at end of file
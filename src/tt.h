@@ -2,16 +2,29 @@
 
 #include "external/chess.hpp"
 #include "eval.h"
+#include "numa.h"
 #include "parameters.h"
 #include "util.h"
+#include <array>
+#include <atomic>
+#include <bit>
 #include <bitset>
 #include <climits>
 #include <cstring>
+#include <fstream>
+#include <memory>
 #include <iostream>
+#include <string>
 #include <thread>
 #include <vector>
 #if defined(__linux__)
+    #include <fcntl.h>
     #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #ifndef MAP_HUGE_SHIFT
+        #define MAP_HUGE_SHIFT 26
+    #endif
 #endif
 
 
@@ -41,8 +54,9 @@ enum TTFlag : uint8_t { NO_BOUND = 0, EXACT = 1, BETA_CUT = 2, FAIL_LOW = 3 };
 
 // Heavily based off Stormphrax and Sirius
 
-constexpr int ENTRY_COUNT = 3;
 constexpr size_t TT_ALIGNMENT = 64;
+// Heap fallback is aligned to a 2MB page so transparent huge pages can back all of it
+constexpr size_t TT_HEAP_ALIGNMENT = 2 * 1024 * 1024;
 static constexpr int GEN_CYCLE_LENGTH = 1 << 5;
 static constexpr uint32_t AGE_MASK = GEN_CYCLE_LENGTH - 1;
 
@@ -57,14 +71,76 @@ inline int readScore(int score, int ply) {
     return score;
 }
 
-struct TTEntry {
-    uint16_t key16;
+// Hits are bucketed by the depth of the entry, 4 plies per bucket
+constexpr int TT_DEPTH_BUCKETS = 8;
+constexpr int TT_DEPTH_BUCKET_WIDTH = 4;
+
+// Per thread TT counters, merged on demand by the searcher
+struct TTStats {
+    uint64_t probes = 0;
+    uint64_t hits = 0;
+    std::array<uint64_t, TT_DEPTH_BUCKETS> hitsByDepth{};
+    // Hits whose move is not legal in the probed position (key collisions or torn entries)
+    uint64_t corrupt = 0;
+    // Hits whose full key differs from the probed one, only counted with TT_VERIFY
+    uint64_t falsePositives = 0;
+    uint64_t stores = 0;
+    // Stores that overwrote a live entry of another position
+    uint64_t replacements = 0;
+    // Replacements where the victim was from an older search
+    uint64_t ageEvictions = 0;
+    // Stores rejected because the existing entry was more valuable
+    uint64_t skippedStores = 0;
+    // Prefetched keys that differ from the key after the move, only counted with PREFETCH_VERIFY
+    uint64_t prefetchMismatches = 0;
+
+    void merge(const TTStats& other) {
+        probes += other.probes;
+        hits += other.hits;
+        for (int i = 0; i < TT_DEPTH_BUCKETS; i++)
+            hitsByDepth[i] += other.hitsByDepth[i];
+        corrupt += other.corrupt;
+        falsePositives += other.falsePositives;
+        stores += other.stores;
+        replacements += other.replacements;
+        ageEvictions += other.ageEvictions;
+        skippedStores += other.skippedStores;
+        prefetchMismatches += other.prefetchMismatches;
+    }
+};
+
+// Key is the type of the stored verification key, the low bits of the zobrist key
+template <typename Key> struct TTEntry {
+    Key storedKey;
     int16_t score;
     int16_t staticEval;
     uint16_t bestMove;
     uint8_t depth;
     uint8_t flags;
 
+    // Lockless layout (build with TT_LOCKLESS)
+    // The stored key is xored with a fold of the payload, so an entry whose key and
+    // data were written by different threads fails the key comparison instead of
+    // handing out a mismatched move and score
+    Key checksum() const {
+#ifdef TT_LOCKLESS
+        uint64_t data = static_cast<uint16_t>(score) | static_cast<uint64_t>(static_cast<uint16_t>(staticEval)) << 16 |
+                        static_cast<uint64_t>(bestMove) << 32 | static_cast<uint64_t>(depth) << 48 |
+                        static_cast<uint64_t>(flags) << 56;
+        data ^= data >> 32;
+        if constexpr (sizeof(Key) < 4)
+            data ^= data >> 16;
+        return static_cast<Key>(data);
+#else
+        return 0;
+#endif
+    }
+
+    Key key() const { return storedKey ^ checksum(); }
+
+    // Must be called after the payload is written
+    void setKey(Key key) { storedKey = key ^ checksum(); }
+
     bool pv() { return (flags >> 2) & 1; }
 
     uint8_t gen() { return flags >> 3; }
@@ -85,47 +161,154 @@ struct ProbedTTEntry {
     uint8_t bound;
 };
 
-struct alignas(32) TTCluster {
-    TTEntry entries[ENTRY_COUNT];
-    char padding[2];
+// Cluster geometry, selected at build time with TT_LAYOUT
+// 32x3:    3 entries with 16 bit keys in 32 bytes (default)
+// 64x6:    6 entries with 16 bit keys in a 64 byte cache line
+// 64x5k32: 5 entries with 32 bit keys in a 64 byte cache line
+template <typename KeyType, int Entries, size_t Bytes> struct alignas(Bytes) TTClusterLayout {
+    using Key = KeyType;
+    using Entry = TTEntry<Key>;
+    static constexpr int ENTRY_COUNT = Entries;
+
+    Entry entries[Entries];
+};
+
+#if defined(TT_LAYOUT_64X6)
+using TTCluster = TTClusterLayout<uint16_t, 6, 64>;
+#elif defined(TT_LAYOUT_64X5_K32)
+using TTCluster = TTClusterLayout<uint32_t, 5, 64>;
+#else
+using TTCluster = TTClusterLayout<uint16_t, 3, 32>;
+#endif
+
+// TT snapshot file: this header followed by the raw cluster array
+struct TTSnapshotHeader {
+    char magic[8];
+    uint64_t version;
+    uint64_t mbSize;
+    uint64_t clusterCount;
+    uint64_t clusterBytes;
+    uint64_t networkHash;
+    uint64_t age;
+    uint64_t layout;
 };
+static_assert(sizeof(TTSnapshotHeader) % TT_ALIGNMENT == 0);
+
+constexpr char TT_SNAPSHOT_MAGIC[8] = {'T', 'A', 'R', 'N', 'H', 'A', 'S', 'H'};
+constexpr uint64_t TT_SNAPSHOT_VERSION = 1;
 
-class TTable {
+enum class TTMemory { HEAP, HUGETLB, SNAPSHOT };
+
+template <typename Cluster> class TTableImpl {
+    using Key = typename Cluster::Key;
+    using Entry = typename Cluster::Entry;
+    static constexpr int ENTRY_COUNT = Cluster::ENTRY_COUNT;
+    static constexpr uint64_t LAYOUT = ENTRY_COUNT | sizeof(Key) << 8 | sizeof(Cluster) << 16;
 
 public:
     int mbSize = 16;
-    TTable() {
+    TTableImpl() {
         resize(16);
     }
-    ~TTable() {
-        std::free(clusters);
+    ~TTableImpl() {
+        waitForClear();
+        release();
+    }
+
+    static size_t clusterCountFor(uint64_t mb) {
+        return mb * 1024 * 1024 / sizeof(Cluster);
+    }
+
+    static std::string layoutInfo() {
+        return std::to_string(ENTRY_COUNT) + " entries with " + std::to_string(sizeof(Key) * 8) + " bit keys in " +
+               std::to_string(sizeof(Cluster)) + " byte clusters";
     }
 
-    void resize(int mb = 16) {
+    // Resizes the table while keeping its contents. The new memory is zeroed and the
+    // old entries are rehashed into it in parallel. Only the low key bits are stored,
+    // while index() uses the high bits, so an entry is offered to every new cluster
+    // whose key range overlaps its old cluster. When growing, all but one of those
+    // copies are in the wrong cluster and can still give false hits there, so they are
+    // stored half a generation cycle old to be replaced before any fresh entry
+    void resize(int mb = 16, int numThreads = 1) {
+        waitForClear();
         mbSize = mb;
-        size_t clusterCount = static_cast<uint64_t>(mb) * 1024 * 1024 / sizeof(TTCluster);
+        size_t clusterCount = clusterCountFor(mb);
         if (clusterCount == size)
             return;
 
-        std::free(clusters);
+        Cluster* oldClusters = clusters;
+        size_t oldSize = size;
+        void* oldMapping = mapping;
+        size_t oldMappingBytes = mappingBytes;
 
+        mapping = nullptr;
         size = clusterCount;
-        clusters = static_cast<TTCluster*>(alignedAlloc(TT_ALIGNMENT, size * sizeof(TTCluster)));
-        currAge = 0;
+        allocate(size * sizeof(Cluster));
+#ifdef TT_VERIFY
+        // Full keys of rehashed entries are unknown, 0 skips the check
+        fullKeys = std::make_unique<std::atomic<uint64_t>[]>(size * ENTRY_COUNT);
+#endif
+
+        bool growing = size > oldSize;
+        parallelFor(numThreads, [&](size_t begin, size_t end) {
+            std::fill(clusters + begin, clusters + end, Cluster{});
+            if (oldClusters == nullptr)
+                return;
+            for (size_t i = begin; i < end; i++) {
+                size_t first = static_cast<u128>(i) * oldSize / size;
+                size_t last = (static_cast<u128>(i + 1) * oldSize - 1) / size;
+                for (size_t j = first; j <= last; j++) {
+                    for (auto& entry : oldClusters[j].entries) {
+                        if (entry.bound() != TTFlag::NO_BOUND)
+                            rehash(clusters[i], growing ? aged(entry) : entry);
+                    }
+                }
+            }
+        });
+
+        freeClusters(oldClusters, oldMapping, oldMappingBytes);
+    }
+
+    size_t bytes() const {
+        return size * sizeof(Cluster);
+    }
+    const void* data() const {
+        return clusters;
+    }
+
+    std::string allocationInfo() {
+        std::string info = "Hash " + std::to_string(mbSize) + "MB";
+        if (memory == TTMemory::SNAPSHOT)
+            info += " mapped from snapshot with 4KB pages";
+        else if (memory == TTMemory::HUGETLB)
+            info += std::string(" using ") + (pageSize >= (1ULL << 30) ? "1GB" : "2MB") + " huge pages";
+        else
+            info += " using 4KB pages (transparent huge pages requested)";
+        if (interleaved)
+            info += ", interleaved over " + std::to_string(NUMA::nodes().size()) + " NUMA nodes";
+        return info;
     }
 
     void prefetch(uint64_t key) {
         __builtin_prefetch(&clusters[index(key)]);
     }
 
-    bool probe(uint64_t key, int ply, ProbedTTEntry& ttData) {
+    bool probe(uint64_t key, int ply, ProbedTTEntry& ttData, TTStats& stats) {
         size_t idx = index(key);
-        TTCluster& cluster = clusters[idx];
-        int entryIdx = -1;
-        uint16_t key16 = static_cast<uint16_t>(key);
+        Cluster& cluster = clusters[idx];
+        Key shortKey = static_cast<Key>(key);
+        stats.probes++;
 
+        if (clearing.load(std::memory_order_acquire) && !isCleared(idx))
+            return false;
+
+        // Read each entry once so the key check and the returned data come from the same copy
+        Entry entry;
+        int entryIdx = -1;
         for (int i = 0; i < ENTRY_COUNT; i++) {
-            if (cluster.entries[i].key16 == key16) {
+            entry = cluster.entries[i];
+            if (entry.key() == shortKey) {
                 entryIdx = i;
                 break;
             }
@@ -134,7 +317,13 @@ public:
         if (entryIdx == -1)
             return false;
 
-        auto entry = cluster.entries[entryIdx];
+        stats.hits++;
+        stats.hitsByDepth[std::min<int>(entry.depth / TT_DEPTH_BUCKET_WIDTH, TT_DEPTH_BUCKETS - 1)]++;
+#ifdef TT_VERIFY
+        uint64_t fullKey = fullKeys[idx * ENTRY_COUNT + entryIdx].load(std::memory_order_relaxed);
+        if (fullKey != 0 && fullKey != key)
+            stats.falsePositives++;
+#endif
 
         ttData.score = readScore(entry.score, ply);
         ttData.staticEval = entry.staticEval;
@@ -146,20 +335,21 @@ public:
         return true;
     }
 
-    void store(uint64_t key, Move move, int score, int staticEval, uint8_t bound, int depth, int ply, bool pv) {
-        uint16_t key16 = static_cast<uint16_t>(key);
-        TTCluster& cluster = clusters[index(key)];
+    void store(uint64_t key, Move move, int score, int staticEval, uint8_t bound, int depth, int ply, bool pv,
+               TTStats& stats) {
+        Key shortKey = static_cast<Key>(key);
+        size_t idx = index(key);
+        Cluster& cluster = clusters[idx];
 
-        auto entryValue = [this](auto& entry) {
-            int32_t relativeAge = (GEN_CYCLE_LENGTH + currAge - entry.gen()) & AGE_MASK;
-            return entry.depth - relativeAge * 2;
-        };
+        // The background clear still owns clusters it has not reached, drop the store
+        if (clearing.load(std::memory_order_acquire) && !isCleared(idx))
+            return;
 
-        TTEntry* entryPtr = nullptr;
+        Entry* entryPtr = nullptr;
         auto minValue = std::numeric_limits<int32_t>::max();
 
         for (auto& candidate : cluster.entries) {
-            if (candidate.key16 == key16 || candidate.bound() == TTFlag::NO_BOUND) {
+            if (candidate.key() == shortKey || candidate.bound() == TTFlag::NO_BOUND) {
                 entryPtr = &candidate;
                 break;
             }
@@ -173,41 +363,175 @@ public:
 
         auto entry = *entryPtr;
 
-        if ( !(bound == TTFlag::EXACT || key16 != entry.key16 || entry.gen() != currAge || depth + 4 + pv * 2 > entry.depth) )
+        if ( !(bound == TTFlag::EXACT || shortKey != entry.key() || entry.gen() != currAge || depth + 4 + pv * 2 > entry.depth) ) {
+            stats.skippedStores++;
             return;
+        }
 
-        if (!moveIsNull(move) || key16 != entry.key16)
+        stats.stores++;
+        if (shortKey != entry.key() && entry.bound() != TTFlag::NO_BOUND) {
+            stats.replacements++;
+            if (entry.gen() != currAge)
+                stats.ageEvictions++;
+        }
+
+        if (!moveIsNull(move) || shortKey != entry.key())
             entry.bestMove = move.move();
 
-        entry.key16 = key16;
         entry.score = static_cast<int16_t>(storeScore(score, ply));
         entry.staticEval = static_cast<int16_t>(staticEval);
         entry.depth = static_cast<uint8_t>(depth);
         entry.setFlag(pv, currAge, bound);
+        entry.setKey(shortKey);
 
         *entryPtr = entry;
+#ifdef TT_VERIFY
+        fullKeys[idx * ENTRY_COUNT + (entryPtr - cluster.entries)].store(key, std::memory_order_relaxed);
+#endif
     }
 
     void incAge() {
-        currAge = (currAge + 1) % GEN_CYCLE_LENGTH;
+        uint32_t age = currAge.load(std::memory_order_relaxed);
+        while (!currAge.compare_exchange_weak(age, (age + 1) % GEN_CYCLE_LENGTH, std::memory_order_relaxed)) {
+        }
     }
     void clear(int numThreads = 1) {
+        waitForClear();
         currAge = 0;
-        std::vector<std::jthread> threads;
-        threads.reserve(numThreads);
+        parallelFor(numThreads, [this](size_t begin, size_t end) {
+            std::fill(clusters + begin, clusters + end, Cluster{});
+#ifdef TT_VERIFY
+            for (size_t i = begin * ENTRY_COUNT; i < end * ENTRY_COUNT; i++)
+                fullKeys[i].store(0, std::memory_order_relaxed);
+#endif
+        });
+    }
+
+    // Clears the table on background threads and returns immediately. Until a cluster
+    // has been zeroed, probes treat it as empty and stores to it are dropped
+    void clearAsync(int numThreads = 1) {
+        waitForClear();
+        currAge = 0;
+        numThreads = std::max(numThreads, 1);
+#ifdef TT_VERIFY
+        for (size_t i = 0; i < size * ENTRY_COUNT; i++)
+            fullKeys[i].store(0, std::memory_order_relaxed);
+#endif
+        clearProgress = std::vector<std::atomic<size_t>>(numThreads);
+        for (int i = 0; i < numThreads; i++)
+            clearProgress[i].store(size * i / numThreads);
+        clearWorkers = numThreads;
+        clearing.store(true, std::memory_order_release);
         for (int i = 0; i < numThreads; i++) {
-            threads.emplace_back(
-                [i, this, numThreads]() {
-                    auto begin = clusters + size * i / numThreads;
-                    auto end = clusters + size * (i + 1) / numThreads;
-                    std::fill(begin, end, TTCluster{});
-                });
+            clearThreads.emplace_back([this, i, numThreads]() {
+                constexpr size_t CHUNK = 1 << 14;
+                size_t end = size * (i + 1) / numThreads;
+                for (size_t begin = clearProgress[i]; begin < end; begin += CHUNK) {
+                    size_t chunkEnd = std::min(begin + CHUNK, end);
+                    std::fill(clusters + begin, clusters + chunkEnd, Cluster{});
+                    clearProgress[i].store(chunkEnd, std::memory_order_release);
+                }
+                // Release pairs with the acquire in probe and store, a search that sees
+                // the clear finished also sees every zeroed cluster
+                if (clearWorkers.fetch_sub(1) == 1)
+                    clearing.store(false, std::memory_order_release);
+            });
         }
     }
 
+    void waitForClear() {
+        clearThreads.clear();
+    }
+
+    bool isClearing() {
+        return clearing;
+    }
+
+    bool save(const std::string& path) {
+        waitForClear();
+        TTSnapshotHeader header{};
+        std::memcpy(header.magic, TT_SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = TT_SNAPSHOT_VERSION;
+        header.mbSize = mbSize;
+        header.clusterCount = size;
+        header.clusterBytes = sizeof(Cluster);
+        header.networkHash = networkHash();
+        header.age = currAge;
+        header.layout = LAYOUT;
+
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(clusters), size * sizeof(Cluster));
+        return static_cast<bool>(out);
+    }
+
+    // On Linux the snapshot is mapped copy-on-write, so the table is usable right away
+    // and pages are only read in as they are probed
+    bool load(const std::string& path, std::string& error) {
+        waitForClear();
+        std::ifstream in(path, std::ios::binary);
+        TTSnapshotHeader header{};
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            error = "cannot read " + path;
+            return false;
+        }
+        if (std::memcmp(header.magic, TT_SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != TT_SNAPSHOT_VERSION || header.clusterBytes != sizeof(Cluster) || header.layout != LAYOUT ||
+            header.clusterCount != clusterCountFor(header.mbSize)) {
+            error = "not a compatible hash snapshot";
+            return false;
+        }
+        if (header.networkHash != networkHash()) {
+            error = "snapshot was built with a different network";
+            return false;
+        }
+        size_t bytes = sizeof(header) + header.clusterCount * sizeof(Cluster);
+
+#if defined(__linux__)
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) != bytes) {
+            if (fd >= 0)
+                close(fd);
+            error = "snapshot size does not match its header";
+            return false;
+        }
+        void* base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) {
+            error = "mmap failed";
+            return false;
+        }
+        release();
+        mapping = base;
+        mappingBytes = bytes;
+        memory = TTMemory::SNAPSHOT;
+        pageSize = 4096;
+        interleaved = false;
+        clusters = reinterpret_cast<Cluster*>(static_cast<char*>(base) + sizeof(header));
+        size = header.clusterCount;
+    #ifdef TT_VERIFY
+        fullKeys = std::make_unique<std::atomic<uint64_t>[]>(size * ENTRY_COUNT);
+    #endif
+#else
+        resize(header.mbSize);
+        if (!in.read(reinterpret_cast<char*>(clusters), size * sizeof(Cluster))) {
+            error = "snapshot is truncated";
+            clear();
+            return false;
+        }
+#endif
+        mbSize = header.mbSize;
+        currAge = header.age;
+        return true;
+    }
+
     int hashfull() {
         int count = 0;
+        bool partial = clearing.load(std::memory_order_acquire);
         for (int i = 0; i < 1000; i++) {
+            if (partial && !isCleared(i))
+                continue;
             for (int j = 0; j < ENTRY_COUNT; j++) {
                 auto& entry = clusters[i].entries[j];
                 if (entry.bound() != TTFlag::NO_BOUND && entry.gen() == currAge)
@@ -218,10 +542,128 @@ public:
     }
 
 private:
-    TTCluster* clusters;
-    size_t size;
-    uint32_t currAge;
-    uint32_t index(uint64_t key) {
-        return static_cast<std::uint64_t>((static_cast<u128>(key) * static_cast<u128>(size)) >> 64);
+    Cluster* clusters = nullptr;
+    size_t size = 0;
+    // Atomic so batch analysis can age a table shared by running searches
+    std::atomic<uint32_t> currAge = 0;
+    // Set when the table is a mapping (huge pages or a snapshot) rather than a heap allocation
+    void* mapping = nullptr;
+    size_t mappingBytes = 0;
+#ifdef TT_VERIFY
+    // Full zobrist key of every entry, kept outside the clusters so the layout is unchanged.
+    // Threads race on entries just like on the clusters, so accesses are relaxed atomics
+    std::unique_ptr<std::atomic<uint64_t>[]> fullKeys;
+#endif
+    TTMemory memory = TTMemory::HEAP;
+    size_t pageSize = 4096;
+    bool interleaved = false;
+
+    // Background clear state, clusters of slice i below clearProgress[i] are zeroed
+    std::atomic<bool> clearing = false;
+    std::atomic<int> clearWorkers = 0;
+    std::vector<std::atomic<size_t>> clearProgress;
+    std::vector<std::jthread> clearThreads;
+
+    // Try explicit huge pages (1GB, then 2MB) and fall back to an aligned heap allocation.
+    // 1GB pages are only used for whole multiples of 1GB, rounding e.g. 1536MB up to
+    // 2GB would waste the rest of the last page. 2MB pages waste at most one page.
+    // The pages are interleaved over NUMA nodes before clear() first touches them
+    void allocate(size_t bytes) {
+#if defined(__linux__)
+        for (size_t huge : {1ULL << 30, 1ULL << 21}) {
+            if (bytes < huge || (huge == 1ULL << 30 && bytes % huge != 0))
+                continue;
+            size_t rounded = (bytes + huge - 1) / huge * huge;
+            int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (std::countr_zero(huge) << MAP_HUGE_SHIFT);
+            void* ptr = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, flags, -1, 0);
+            if (ptr == MAP_FAILED)
+                continue;
+            mapping = ptr;
+            mappingBytes = rounded;
+            memory = TTMemory::HUGETLB;
+            pageSize = huge;
+            interleaved = NUMA::interleave(ptr, rounded);
+            clusters = static_cast<Cluster*>(ptr);
+            return;
+        }
+#endif
+        size_t rounded = (bytes + TT_HEAP_ALIGNMENT - 1) / TT_HEAP_ALIGNMENT * TT_HEAP_ALIGNMENT;
+        clusters = static_cast<Cluster*>(alignedAlloc(TT_HEAP_ALIGNMENT, rounded));
+        memory = TTMemory::HEAP;
+        pageSize = 4096;
+        interleaved = NUMA::interleave(clusters, rounded);
     }
-};
\ No newline at end of file
+
+    static void freeClusters(Cluster* ptr, void* map, size_t mapBytes) {
+#if defined(__linux__)
+        if (map != nullptr) {
+            munmap(map, mapBytes);
+            return;
+        }
+#endif
+        std::free(ptr);
+    }
+
+    void release() {
+        freeClusters(clusters, mapping, mappingBytes);
+        mapping = nullptr;
+        clusters = nullptr;
+    }
+
+    // Runs f(begin, end) over equal slices of the cluster range on numThreads threads
+    template <typename F> void parallelFor(int numThreads, F f) {
+        numThreads = std::max(numThreads, 1);
+        std::vector<std::jthread> threads;
+        threads.reserve(numThreads);
+        for (int i = 0; i < numThreads; i++)
+            threads.emplace_back([&, i]() { f(size * i / numThreads, size * (i + 1) / numThreads); });
+    }
+
+    bool isCleared(size_t idx) {
+        size_t slices = clearProgress.size();
+        size_t slice = idx * slices / size;
+        // Slice boundaries round down, so idx can belong to the next slice
+        if (slice + 1 < slices && idx >= size * (slice + 1) / slices)
+            slice++;
+        return idx < clearProgress[slice].load(std::memory_order_acquire);
+    }
+
+    int32_t entryValue(Entry& entry) {
+        int32_t relativeAge = (GEN_CYCLE_LENGTH + currAge - entry.gen()) & AGE_MASK;
+        return entry.depth - relativeAge * 2;
+    }
+
+    // Copy of an entry at least half a generation cycle old, without wrapping around to fresh
+    Entry aged(Entry entry) {
+        uint32_t relativeAge = (GEN_CYCLE_LENGTH + currAge - entry.gen()) & AGE_MASK;
+        relativeAge = std::max<uint32_t>(relativeAge, GEN_CYCLE_LENGTH / 2);
+        Key key = entry.key();
+        entry.setFlag(entry.pv(), (GEN_CYCLE_LENGTH + currAge - relativeAge) & AGE_MASK, entry.bound());
+        entry.setKey(key);
+        return entry;
+    }
+
+    // Places a copied entry into a cluster, evicting the least valuable one if it is worth more
+    void rehash(Cluster& cluster, Entry entry) {
+        Entry* slot = nullptr;
+        auto minValue = std::numeric_limits<int32_t>::max();
+        for (auto& candidate : cluster.entries) {
+            if (candidate.bound() == TTFlag::NO_BOUND) {
+                candidate = entry;
+                return;
+            }
+            auto value = entryValue(candidate);
+            if (value < minValue) {
+                slot = &candidate;
+                minValue = value;
+            }
+        }
+        if (entryValue(entry) > minValue)
+            *slot = entry;
+    }
+    size_t index(uint64_t key) {
+        return static_cast<size_t>((static_cast<u128>(key) * static_cast<u128>(size)) >> 64);
+    }
+};
+
+using TTable = TTableImpl<TTCluster>;
@@ -22,6 +22,7 @@ enum InputCommands {
     POSITION = 17,
     SETOPTION = 96,
     UCINEWGAME = 6,
+    PONDERHIT = 118,
     // Non-UCI
     BENCH = 99,
     EVAL = 26,
@@ -30,7 +31,11 @@ enum InputCommands {
     WAIT = 15,
     CONFIG = 13,
     QUANT = 126,
-    NETSCALE = 121
+    NETSCALE = 121,
+    SAVEHASH = 27,
+    THREADBENCH = 108,
+    BATCH = 125,
+    SEEBENCH = 25
 };
 static bool GetInput(char* str) {
     memset(str, 0, INPUT_SIZE);
@@ -4,6 +4,7 @@
 #include <bit>
 #include <cassert>
 #include <cstring>
+#include <fstream>
 #include <sstream>
 #include <vector>
 
@@ -21,6 +22,58 @@ uint64_t resetPawnHash(Board& board) {
     }
     return key;
 }
+// Exact zobrist key after a pseudo legal move (or a null move), without making it.
+// Mirrors Board::makeMove, including castling rights and the en passant square
+uint64_t hashAfter(Board& board, Move move) {
+    uint64_t key = board.hash() ^ Zobrist::sideToMove();
+    if (board.enpassantSq() != Square::NO_SQ)
+        key ^= Zobrist::enpassant(board.enpassantSq().file());
+    if (move == Move::NULL_MOVE)
+        return key;
+
+    Color stm = board.sideToMove();
+    Piece piece = board.at(move.from());
+    Piece captured = board.at(move.to());
+    PieceType pt = piece.type();
+    Board::CastlingRights cr = board.castlingRights();
+    int oldRights = cr.hashIndex();
+
+    if (move.typeOf() == Move::CASTLING) {
+        bool kingSide = move.to() > move.from();
+        key ^= Zobrist::piece(piece, move.from()) ^ Zobrist::piece(piece, Square::castling_king_square(kingSide, stm));
+        key ^= Zobrist::piece(captured, move.to()) ^ Zobrist::piece(captured, Square::castling_rook_square(kingSide, stm));
+    } else {
+        if (captured != Piece::NONE) {
+            key ^= Zobrist::piece(captured, move.to());
+            if (captured.type() == PieceType::ROOK && Rank::back_rank(move.to().rank(), ~stm)) {
+                auto side = Board::CastlingRights::closestSide(move.to(), board.kingSq(~stm));
+                if (cr.getRookFile(~stm, side) == move.to().file())
+                    cr.clear(~stm, side);
+            }
+        }
+        Piece placed = move.typeOf() == Move::PROMOTION ? Piece(move.promotionType(), stm) : piece;
+        key ^= Zobrist::piece(piece, move.from()) ^ Zobrist::piece(placed, move.to());
+
+        if (move.typeOf() == Move::ENPASSANT)
+            key ^= Zobrist::piece(Piece(PieceType::PAWN, ~stm), move.to().ep_square());
+    }
+
+    if (pt == PieceType::KING) {
+        cr.clear(stm);
+    } else if (pt == PieceType::ROOK && Square::back_rank(move.from(), stm)) {
+        auto side = Board::CastlingRights::closestSide(move.from(), board.kingSq(stm));
+        if (cr.getRookFile(stm, side) == move.from().file())
+            cr.clear(stm, side);
+    } else if (pt == PieceType::PAWN && Square::value_distance(move.to(), move.from()) == 16) {
+        // Only set when an enemy pawn attacks the square, as in the non exact makeMove
+        if (static_cast<bool>(attacks::pawn(stm, move.to().ep_square()) & board.pieces(PieceType::PAWN, ~stm)))
+            key ^= Zobrist::enpassant(move.to().ep_square().file());
+    }
+
+    if (cr.hashIndex() != oldRights)
+        key ^= Zobrist::castling(oldRights) ^ Zobrist::castling(cr.hashIndex());
+    return key;
+}
 // Nonpawn Hash
 uint64_t resetNonPawnHash(Board& board, Color c) {
     uint64_t key = 0ULL;
@@ -66,28 +119,108 @@ bool isMinor(PieceType pt) {
 }
 
 // Pseudo Legal Check
-bool isLegal(Board& board, Move move) {
-    if (moveIsNull(move))
+// Accepts exactly the moves movegen would generate for this position if they were legal,
+// including the encoding of the move type and promotion piece
+bool isPseudoLegal(Board& board, Move move) {
+    if (moveIsNull(move) || move.from() == move.to())
         return false;
 
     Color stm = board.sideToMove();
-    Piece srcPiece = board.at(move.from());
-
+    Square from = move.from();
+    Square to = move.to();
+    Piece srcPiece = board.at(from);
     if (srcPiece == Piece::NONE || srcPiece.color() != stm)
         return false;
+    PieceType pt = srcPiece.type();
+    Bitboard occ = board.occ();
+    Bitboard toBB = Bitboard::fromSquare(to);
+    Bitboard them = board.them(stm);
+    uint16_t type = move.typeOf();
+
+    // Only promotions carry a promotion piece
+    if (type != Move::PROMOTION && (move.move() >> 12 & 3) != 0)
+        return false;
+
+    if (type == Move::CASTLING) {
+        if (pt != PieceType::KING || board.inCheck() || board.at(to) != Piece(PieceType::ROOK, stm))
+            return false;
+        Board::CastlingRights rights = board.castlingRights();
+        bool kingSide = to > from;
+        Board::CastlingRights::Side side = kingSide ? Board::CastlingRights::Side::KING_SIDE : Board::CastlingRights::Side::QUEEN_SIDE;
+        return rights.has(stm, side) && Square::back_rank(from, stm)
+               && to == Square(rights.getRookFile(stm, side), from.rank()) && !(occ & board.getCastlingPath(stm, kingSide));
+    }
 
-    Piece dstPiece = board.at(move.to());
-    PieceType srcPieceType = srcPiece.type();
-    PieceType dstPieceType = dstPiece.type();
+    if (pt == PieceType::PAWN) {
+        bool lastRank = Square::back_rank(to, ~stm);
+        if (type == Move::ENPASSANT)
+            return to == board.enpassantSq() && attacks::pawn(stm, from).check(to.index())
+                   && board.at(to.ep_square()) == Piece(PieceType::PAWN, ~stm);
+        if ((type == Move::PROMOTION) != lastRank)
+            return false;
+        if (attacks::pawn(stm, from) & toBB & them)
+            return true;
+        int forward = stm == Color::WHITE ? 8 : -8;
+        if (to.index() - from.index() == forward)
+            return !occ.check(to.index());
+        // Double push from the starting rank
+        Square startRank = from.relative_square(stm);
+        return to.index() - from.index() == 2 * forward && startRank.rank() == Rank::RANK_2
+               && !occ.check(from.index() + forward) && !occ.check(to.index());
+    }
 
-    // Lazy Solution
-    // Make this sane later
-    Movelist legals;
-    movegen::legalmoves<movegen::MoveGenType::ALL>(legals, board,
-                                                   1 << (int)srcPieceType);
-    if (std::find(legals.begin(), legals.end(), move) == legals.end())
+    if (type != Move::NORMAL || (toBB & board.us(stm)))
         return false;
-    return true;
+    switch (pt.internal()) {
+        case PieceType::KNIGHT: return attacks::knight(from).check(to.index());
+        case PieceType::BISHOP: return attacks::bishop(from, occ).check(to.index());
+        case PieceType::ROOK: return attacks::rook(from, occ).check(to.index());
+        case PieceType::QUEEN: return attacks::queen(from, occ).check(to.index());
+        case PieceType::KING: return attacks::king(from).check(to.index());
+        default: return false;
+    }
+}
+
+// Whether a pseudo legal move leaves our king safe, from the occupancy after the move
+bool isLegalPseudoLegal(Board& board, Move move) {
+    Color stm = board.sideToMove();
+    Square from = move.from();
+    Square to = move.to();
+    Square king = board.kingSq(stm);
+    Bitboard enemy = board.them(stm);
+    Bitboard occ = board.occ();
+
+    if (move.typeOf() == Move::CASTLING) {
+        bool kingSide = to > from;
+        Square kingTo = Square::castling_king_square(kingSide, stm);
+        Square rookTo = Square::castling_rook_square(kingSide, stm);
+        Bitboard withoutKing = occ ^ Bitboard::fromSquare(from);
+        // Every square the king passes must be safe
+        int step = kingTo > from ? 1 : -1;
+        for (int sq = from.index() + step; sq != kingTo.index() + step; sq += step) {
+            if (attackersTo(board, Square(sq), withoutKing) & enemy)
+                return false;
+        }
+        // Chess960, the rook may not be pinned along the back rank
+        Bitboard enemyRQ = board.pieces(PieceType::ROOK, PieceType::QUEEN) & enemy;
+        if (board.chess960() && (attacks::rook(king, occ ^ Bitboard::fromSquare(to)) & ~attacks::rook(king, occ) & enemyRQ))
+            return false;
+        Bitboard after = (occ ^ Bitboard::fromSquare(from) ^ Bitboard::fromSquare(to)) | Bitboard::fromSquare(kingTo)
+                         | Bitboard::fromSquare(rookTo);
+        return !(attackersTo(board, kingTo, after) & enemy);
+    }
+
+    Bitboard captured = Bitboard::fromSquare(to);
+    if (move.typeOf() == Move::ENPASSANT)
+        captured = Bitboard::fromSquare(to.ep_square());
+    Bitboard after = ((occ ^ Bitboard::fromSquare(from)) & ~captured) | Bitboard::fromSquare(to);
+    if (from == king)
+        king = to;
+    return !(attackersTo(board, king, after) & enemy & ~captured);
+}
+
+bool isLegal(Board& board, Move move) {
+    return isPseudoLegal(board, move) && isLegalPseudoLegal(board, move);
 }
 
 // Threats
@@ -168,6 +301,42 @@ int oppDir(int dir) {
     }
     return -1;
 }
+// Tables owned by the engine. chess.hpp keeps its attack tables private, so they are not counted
+size_t lookupBytes() {
+    return sizeof(Rays) + sizeof(BetweenBB) + sizeof(PieceValue);
+}
+
+std::vector<MemoryRegion> memoryRegions() {
+    std::vector<MemoryRegion> regions;
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    while (std::getline(smaps, line)) {
+        uintptr_t start, end;
+        size_t kb;
+        // Mapping headers look like "7f12a000-7f12c000 rw-p ..."
+        if (std::sscanf(line.c_str(), "%lx-%lx ", &start, &end) == 2)
+            regions.push_back({start, end, 4096, 0});
+        else if (!regions.empty() && std::sscanf(line.c_str(), "KernelPageSize: %zu kB", &kb) == 1)
+            regions.back().kernelPageSize = kb * 1024;
+        else if (!regions.empty() && std::sscanf(line.c_str(), "AnonHugePages: %zu kB", &kb) == 1)
+            regions.back().anonHugeBytes = kb * 1024;
+    }
+    return regions;
+}
+
+size_t hugePageBytes(const std::vector<MemoryRegion>& regions, const void* ptr, size_t bytes) {
+    uintptr_t begin = reinterpret_cast<uintptr_t>(ptr);
+    uintptr_t end = begin + bytes;
+    size_t huge = 0;
+    for (const MemoryRegion& region : regions) {
+        if (region.end <= begin || region.start >= end)
+            continue;
+        size_t overlap = std::min(end, region.end) - std::max(begin, region.start);
+        huge += region.kernelPageSize > 4096 ? overlap : std::min(overlap, region.anonHugeBytes);
+    }
+    return huge;
+}
+
 void initLookups() {
     for (Square sq = Square::SQ_A1; sq <= Square::SQ_H8; ++sq) {
         Bitboard bb = Bitboard::fromSquare(sq);
@@ -287,17 +456,26 @@ void pinnersBlockers(Board& board, Color stm, StateInfo* sti) {
         }
     }
 }
-// Stockfish and Sirius
+// Pinners and king blockers of both sides, computed once per node
+StateInfo calculatePins(Board& board) {
+    StateInfo state = StateInfo();
+    pinnersBlockers(board, Color::WHITE, &state);
+    pinnersBlockers(board, Color::BLACK, &state);
+    return state;
+}
+
 bool SEE(Board& board, Move& move, int margin) {
+    return SEE(board, move, margin, calculatePins(board));
+}
+
+// Stockfish and Sirius
+bool SEE(Board& board, Move& move, int margin, const StateInfo& state) {
 
     if (move.typeOf() != Move::NORMAL)
         return 0 >= margin;
 
     Square from = move.from();
     Square to = move.to();
-    StateInfo state = StateInfo();
-    pinnersBlockers(board, Color::WHITE, &state);
-    pinnersBlockers(board, Color::BLACK, &state);
     int swap = PieceValue[(int)board.at<PieceType>(to)] - margin;
     if (swap < 0)
         return false;
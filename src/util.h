@@ -68,10 +68,13 @@ uint64_t resetPawnHash(Board& board);
 uint64_t resetNonPawnHash(Board& board, Color c);
 uint64_t resetMajorHash(Board& board);
 uint64_t resetMinorHash(Board& board);
+uint64_t hashAfter(Board& board, Move move);
 bool isMajor(PieceType pt);
 bool isMinor(PieceType pt);
 
 // Legality
+bool isPseudoLegal(Board& board, Move move);
+bool isLegalPseudoLegal(Board& board, Move move);
 bool isLegal(Board& board, Move move);
 
 // Threats
@@ -82,10 +85,26 @@ void MakeMove(Board& board, Move move, InputBucketCache& bucketCache, Search::St
 void UnmakeMove(Board& board, Move move);
 // SEE stuff
 void initLookups();
+size_t lookupBytes();
 int oppDir(int dir);
 Bitboard attackersTo(Board& board, Square s, Bitboard occ);
 void pinnersBlockers(Board& board, Color c, StateInfo sti);
+StateInfo calculatePins(Board& board);
+// Without cached pins they are computed for this call only
 bool SEE(Board& board, Move& move, int margin);
+bool SEE(Board& board, Move& move, int margin, const StateInfo& state);
+
+// Mappings of this process as listed in /proc/self/smaps, empty elsewhere
+struct MemoryRegion {
+    uintptr_t start;
+    uintptr_t end;
+    size_t kernelPageSize;
+    size_t anonHugeBytes;
+};
+std::vector<MemoryRegion> memoryRegions();
+// Bytes of [ptr, ptr + bytes) backed by huge pages. Transparent huge pages are only reported
+// per mapping, so for those this is an upper bound when the mapping holds other data too
+size_t hugePageBytes(const std::vector<MemoryRegion>& regions, const void* ptr, size_t bytes);
 
 // Util Move
 static bool moveIsNull(Move m) {